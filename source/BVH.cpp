@@ -0,0 +1,447 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace dae {
+	void BVH::Build(const std::vector<AABB>& primitiveBounds)
+	{
+		Clear();
+
+		const uint32_t primitiveCount{ static_cast<uint32_t>(primitiveBounds.size()) };
+		if (primitiveCount == 0)
+			return;
+
+		std::vector<uint32_t>& primitiveIndices = m_PrimitiveIndices.Edit();
+		primitiveIndices.resize(primitiveCount);
+		std::iota(primitiveIndices.begin(), primitiveIndices.end(), 0u);
+
+		//Primitives are binned by the center of their bounds
+		std::vector<Vector3> centroids{};
+		centroids.reserve(primitiveCount);
+		for (const AABB& bounds : primitiveBounds)
+		{
+			centroids.emplace_back(bounds.Center());
+		}
+
+		//A binary tree over N primitives never needs more than 2N - 1 nodes
+		std::vector<BVHNode>& nodes = m_Nodes.Edit();
+		nodes.resize(primitiveCount * 2 - 1);
+		m_NodesUsed = 1;
+
+		BVHNode& root = nodes[0];
+		root.leftFirst = 0;
+		root.primitiveCount = primitiveCount;
+		UpdateNodeBounds(0, primitiveBounds);
+		Subdivide(0, 0, primitiveBounds, centroids);
+
+		nodes.resize(m_NodesUsed);
+		m_BuildCost = CalculateCost();
+		Collapse();
+	}
+
+	void BVH::Refit(const std::vector<AABB>& primitiveBounds)
+	{
+		//Children are always allocated after their parent, so walking backwards visits children first
+		std::vector<BVHNode>& nodes = m_Nodes.Edit();
+		for (int nodeIndex{ static_cast<int>(nodes.size()) - 1 }; nodeIndex >= 0; --nodeIndex)
+		{
+			BVHNode& node = nodes[nodeIndex];
+			if (node.IsLeaf())
+			{
+				UpdateNodeBounds(nodeIndex, primitiveBounds);
+				continue;
+			}
+
+			const BVHNode& leftChild = nodes[node.leftFirst];
+			const BVHNode& rightChild = nodes[node.leftFirst + 1];
+			node.minAABB = Vector3::Min(leftChild.minAABB, rightChild.minAABB);
+			node.maxAABB = Vector3::Max(leftChild.maxAABB, rightChild.maxAABB);
+		}
+
+		Collapse();
+	}
+
+	void BVH::Update(const std::vector<AABB>& primitiveBounds)
+	{
+		//Swap in a finished background rebuild, it was built from older bounds so it still gets refitted below
+		if (m_Rebuild.valid() && m_Rebuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			std::unique_ptr<BVH> pRebuilt{ m_Rebuild.get() };
+			if (pRebuilt->m_PrimitiveIndices.size() == primitiveBounds.size())
+			{
+				m_Nodes = std::move(pRebuilt->m_Nodes);
+				m_PrimitiveIndices = std::move(pRebuilt->m_PrimitiveIndices);
+				m_NodesUsed = pRebuilt->m_NodesUsed;
+				m_BuildCost = pRebuilt->m_BuildCost;
+			}
+		}
+
+		if (m_Nodes.empty() || m_PrimitiveIndices.size() != primitiveBounds.size())
+		{
+			Build(primitiveBounds);
+			return;
+		}
+
+		Refit(primitiveBounds);
+
+		if (!m_Rebuild.valid() && CalculateCost() > m_BuildCost * m_RebuildCostRatio)
+		{
+			m_Rebuild = std::async(std::launch::async, [primitiveBounds, maxLeafSize = m_MaxLeafSize]()
+				{
+					std::unique_ptr<BVH> pRebuilt{ std::make_unique<BVH>() };
+					pRebuilt->SetMaxLeafSize(maxLeafSize);
+					pRebuilt->Build(primitiveBounds);
+					return pRebuilt;
+				});
+		}
+	}
+
+	bool BVH::Load(SharedArray<BVHNode>&& nodes, SharedArray<BVH4Node>&& wideNodes, SharedArray<uint32_t>&& primitiveIndices)
+	{
+		Clear();
+
+		//Every index has to stay inside the arrays, traversal does not check them
+		const size_t primitiveCount{ primitiveIndices.size() };
+		for (const uint32_t primitiveIndex : primitiveIndices)
+		{
+			if (primitiveIndex >= primitiveCount)
+				return false;
+		}
+
+		//Build and CollapseNode always place children after their parent, a child at or before its parent would form a cycle
+		//Parents come first, so one pass in index order knows the depth of every node and traversal stacks never overflow
+		std::vector<uint32_t> depths(nodes.size());
+		for (uint32_t nodeIndex{ 0 }; nodeIndex < nodes.size(); ++nodeIndex)
+		{
+			const BVHNode& node = nodes[nodeIndex];
+			if (node.IsLeaf())
+			{
+				if (size_t{ node.leftFirst } + node.primitiveCount > primitiveCount)
+					return false;
+				continue;
+			}
+
+			if (node.leftFirst <= nodeIndex || size_t{ node.leftFirst } + 1 >= nodes.size() || depths[nodeIndex] + 1 >= MaxDepth)
+				return false;
+			depths[node.leftFirst] = std::max(depths[node.leftFirst], depths[nodeIndex] + 1);
+			depths[node.leftFirst + 1] = std::max(depths[node.leftFirst + 1], depths[nodeIndex] + 1);
+		}
+
+		depths.assign(wideNodes.size(), 0);
+		for (uint32_t wideIndex{ 0 }; wideIndex < wideNodes.size(); ++wideIndex)
+		{
+			const BVH4Node& wideNode = wideNodes[wideIndex];
+			for (int lane{ 0 }; lane < 4; ++lane)
+			{
+				const uint32_t child{ wideNode.child[lane] };
+				if (wideNode.primitiveCount[lane] > 0)
+				{
+					if (size_t{ child } + wideNode.primitiveCount[lane] > primitiveCount)
+						return false;
+					continue;
+				}
+
+				//Unused lanes have inverted bounds and child 0, traversal never enters them
+				const bool isUnused{ wideNode.bounds[0][lane] > wideNode.bounds[3][lane] || wideNode.bounds[1][lane] > wideNode.bounds[4][lane]
+					|| wideNode.bounds[2][lane] > wideNode.bounds[5][lane] };
+				if (isUnused)
+					continue;
+
+				if (child <= wideIndex || child >= wideNodes.size() || depths[wideIndex] + 1 >= MaxDepth)
+					return false;
+				depths[child] = std::max(depths[child], depths[wideIndex] + 1);
+			}
+		}
+		if (nodes.empty() != wideNodes.empty())
+			return false;
+
+		m_Nodes = std::move(nodes);
+		m_WideNodes = std::move(wideNodes);
+		m_PrimitiveIndices = std::move(primitiveIndices);
+		m_NodesUsed = static_cast<uint32_t>(m_Nodes.size());
+		m_BuildCost = CalculateCost();
+		return true;
+	}
+
+	void BVH::AdoptLeafOrder()
+	{
+		std::vector<uint32_t>& primitiveIndices = m_PrimitiveIndices.Edit();
+		std::iota(primitiveIndices.begin(), primitiveIndices.end(), 0u);
+	}
+
+	void BVH::Clear()
+	{
+		m_Nodes = std::vector<BVHNode>{};
+		m_WideNodes = std::vector<BVH4Node>{};
+		m_PrimitiveIndices = std::vector<uint32_t>{};
+		m_NodesUsed = 0;
+		m_BuildCost = 0.f;
+	}
+
+	float BVH::CalculateCost() const
+	{
+		if (m_Nodes.empty())
+			return 0.f;
+
+		const float rootArea{ AABB{ m_Nodes[0].minAABB, m_Nodes[0].maxAABB }.HalfArea() };
+		if (rootArea <= 0.f)
+			return 0.f;
+
+		float cost{};
+		for (const BVHNode& node : m_Nodes)
+		{
+			const float area{ AABB{ node.minAABB, node.maxAABB }.HalfArea() };
+			cost += node.IsLeaf() ? m_IntersectionCost * node.primitiveCount * area : m_TraversalCost * area;
+		}
+
+		return cost / rootArea;
+	}
+
+	void BVH::Collapse()
+	{
+		//Replaced instead of edited, so wide nodes borrowed from a snapshot are not copied just to be overwritten
+		m_WideNodes = std::vector<BVH4Node>{};
+		if (m_Nodes.empty())
+			return;
+
+		//Upper bound: every wide node holds at least two binary nodes, except a root that is a leaf
+		m_WideNodes.Edit().reserve(m_Nodes.size() / 2 + 1);
+
+		//A root that is a single leaf still gets a wide node around it, so traversal always starts at a wide node
+		if (m_Nodes[0].IsLeaf())
+		{
+			BVH4Node root{};
+			for (int lane{ 0 }; lane < 4; ++lane)
+			{
+				root.bounds[0][lane] = root.bounds[1][lane] = root.bounds[2][lane] = FLT_MAX;
+				root.bounds[3][lane] = root.bounds[4][lane] = root.bounds[5][lane] = -FLT_MAX;
+			}
+
+			const BVHNode& leaf = m_Nodes[0];
+			root.bounds[0][0] = leaf.minAABB.x;
+			root.bounds[1][0] = leaf.minAABB.y;
+			root.bounds[2][0] = leaf.minAABB.z;
+			root.bounds[3][0] = leaf.maxAABB.x;
+			root.bounds[4][0] = leaf.maxAABB.y;
+			root.bounds[5][0] = leaf.maxAABB.z;
+			root.child[0] = leaf.leftFirst;
+			root.primitiveCount[0] = leaf.primitiveCount;
+
+			m_WideNodes.Edit().push_back(root);
+			return;
+		}
+
+		CollapseNode(0);
+	}
+
+	uint32_t BVH::CollapseNode(uint32_t nodeIndex)
+	{
+		//Open the largest interior child until there are four children or only leaves are left
+		uint32_t children[4]{ m_Nodes[nodeIndex].leftFirst, m_Nodes[nodeIndex].leftFirst + 1 };
+		int childCount{ 2 };
+		while (childCount < 4)
+		{
+			int largestChild{ -1 };
+			float largestArea{ -1.f };
+			for (int i{ 0 }; i < childCount; ++i)
+			{
+				const BVHNode& child = m_Nodes[children[i]];
+				if (child.IsLeaf())
+					continue;
+
+				const float area{ AABB{ child.minAABB, child.maxAABB }.HalfArea() };
+				if (area > largestArea)
+				{
+					largestArea = area;
+					largestChild = i;
+				}
+			}
+
+			if (largestChild < 0)
+				break;
+
+			const uint32_t openedIndex{ children[largestChild] };
+			children[largestChild] = m_Nodes[openedIndex].leftFirst;
+			children[childCount++] = m_Nodes[openedIndex].leftFirst + 1;
+		}
+
+		const uint32_t wideIndex{ static_cast<uint32_t>(m_WideNodes.size()) };
+		m_WideNodes.Edit().emplace_back();
+
+		//Children are collapsed first, m_WideNodes may grow so the node is only written afterwards
+		BVH4Node wideNode{};
+		for (int lane{ 0 }; lane < 4; ++lane)
+		{
+			if (lane >= childCount)
+			{
+				wideNode.bounds[0][lane] = wideNode.bounds[1][lane] = wideNode.bounds[2][lane] = FLT_MAX;
+				wideNode.bounds[3][lane] = wideNode.bounds[4][lane] = wideNode.bounds[5][lane] = -FLT_MAX;
+				continue;
+			}
+
+			const BVHNode& child = m_Nodes[children[lane]];
+			wideNode.bounds[0][lane] = child.minAABB.x;
+			wideNode.bounds[1][lane] = child.minAABB.y;
+			wideNode.bounds[2][lane] = child.minAABB.z;
+			wideNode.bounds[3][lane] = child.maxAABB.x;
+			wideNode.bounds[4][lane] = child.maxAABB.y;
+			wideNode.bounds[5][lane] = child.maxAABB.z;
+
+			wideNode.primitiveCount[lane] = child.primitiveCount;
+			wideNode.child[lane] = child.IsLeaf() ? child.leftFirst : CollapseNode(children[lane]);
+		}
+
+		m_WideNodes.Edit()[wideIndex] = wideNode;
+		return wideIndex;
+	}
+
+	void BVH::UpdateNodeBounds(uint32_t nodeIndex, const std::vector<AABB>& primitiveBounds)
+	{
+		BVHNode& node = m_Nodes.Edit()[nodeIndex];
+
+		AABB bounds{};
+		for (uint32_t i{ 0 }; i < node.primitiveCount; ++i)
+		{
+			bounds.Grow(primitiveBounds[m_PrimitiveIndices[node.leftFirst + i]]);
+		}
+
+		node.minAABB = bounds.min;
+		node.maxAABB = bounds.max;
+	}
+
+	void BVH::Subdivide(uint32_t nodeIndex, uint32_t depth, const std::vector<AABB>& primitiveBounds, const std::vector<Vector3>& centroids)
+	{
+		std::vector<BVHNode>& nodes = m_Nodes.Edit();
+		BVHNode& node = nodes[nodeIndex];
+		if (node.primitiveCount <= 1 || depth + 1 >= MaxDepth)
+			return;
+
+		int axis{};
+		uint32_t splitBin{};
+		AABB centroidBounds{};
+		const float splitCost{ FindBestSplit(node, primitiveBounds, centroids, axis, splitBin, centroidBounds) };
+
+		//Only split when it is cheaper than intersecting every primitive in this node, or when the leaf would be too large
+		const AABB nodeBounds{ node.minAABB, node.maxAABB };
+		const float leafCost{ m_IntersectionCost * node.primitiveCount * nodeBounds.HalfArea() };
+		const bool isTooLarge{ node.primitiveCount > m_MaxLeafSize };
+		if (splitCost >= leafCost && !isTooLarge)
+			return;
+
+		uint32_t leftCount{};
+		if (splitCost < FLT_MAX)
+		{
+			//Partition the primitive indices in place, using the same binning as the split search
+			const float binScale{ m_BinCount / (centroidBounds.max[axis] - centroidBounds.min[axis]) };
+			const auto first = m_PrimitiveIndices.Edit().begin() + node.leftFirst;
+			const auto last = first + node.primitiveCount;
+			const auto middle = std::partition(first, last, [&](uint32_t primitiveIndex)
+				{
+					const uint32_t bin{ std::min(m_BinCount - 1,
+						static_cast<uint32_t>((centroids[primitiveIndex][axis] - centroidBounds.min[axis]) * binScale)) };
+					return bin <= splitBin;
+				});
+			leftCount = static_cast<uint32_t>(middle - first);
+		}
+
+		//Primitives with coinciding centroids can't be binned apart, a leaf that is too large is then cut in half
+		if (leftCount == 0 || leftCount == node.primitiveCount)
+		{
+			if (!isTooLarge)
+				return;
+
+			leftCount = node.primitiveCount / 2;
+		}
+
+		//Children are always allocated as a pair
+		const uint32_t leftChildIndex{ m_NodesUsed++ };
+		const uint32_t rightChildIndex{ m_NodesUsed++ };
+
+		nodes[leftChildIndex].leftFirst = node.leftFirst;
+		nodes[leftChildIndex].primitiveCount = leftCount;
+		nodes[rightChildIndex].leftFirst = node.leftFirst + leftCount;
+		nodes[rightChildIndex].primitiveCount = node.primitiveCount - leftCount;
+
+		node.leftFirst = leftChildIndex;
+		node.primitiveCount = 0;
+
+		UpdateNodeBounds(leftChildIndex, primitiveBounds);
+		UpdateNodeBounds(rightChildIndex, primitiveBounds);
+
+		Subdivide(leftChildIndex, depth + 1, primitiveBounds, centroids);
+		Subdivide(rightChildIndex, depth + 1, primitiveBounds, centroids);
+	}
+
+	float BVH::FindBestSplit(const BVHNode& node, const std::vector<AABB>& primitiveBounds, const std::vector<Vector3>& centroids,
+		int& bestAxis, uint32_t& bestBin, AABB& centroidBounds) const
+	{
+		struct Bin
+		{
+			AABB bounds{};
+			uint32_t count{};
+		};
+
+		centroidBounds = AABB{};
+		for (uint32_t i{ 0 }; i < node.primitiveCount; ++i)
+		{
+			centroidBounds.Grow(centroids[m_PrimitiveIndices[node.leftFirst + i]]);
+		}
+
+		float bestCost{ FLT_MAX };
+		for (int axis{ 0 }; axis < 3; ++axis)
+		{
+			const float boundsMin{ centroidBounds.min[axis] };
+			const float extent{ centroidBounds.max[axis] - boundsMin };
+			if (extent <= 0.f)
+				continue;
+
+			//Fill the bins
+			Bin bins[m_BinCount]{};
+			const float binScale{ m_BinCount / extent };
+			for (uint32_t i{ 0 }; i < node.primitiveCount; ++i)
+			{
+				const uint32_t primitiveIndex{ m_PrimitiveIndices[node.leftFirst + i] };
+				const uint32_t bin{ std::min(m_BinCount - 1,
+					static_cast<uint32_t>((centroids[primitiveIndex][axis] - boundsMin) * binScale)) };
+				bins[bin].bounds.Grow(primitiveBounds[primitiveIndex]);
+				++bins[bin].count;
+			}
+
+			//Sweep from both sides to get the area and count on each side of every plane between two bins
+			float leftArea[m_BinCount - 1]{}, rightArea[m_BinCount - 1]{};
+			uint32_t leftCount[m_BinCount - 1]{}, rightCount[m_BinCount - 1]{};
+			AABB leftBounds{}, rightBounds{};
+			uint32_t leftSum{}, rightSum{};
+			for (uint32_t i{ 0 }; i < m_BinCount - 1; ++i)
+			{
+				leftSum += bins[i].count;
+				leftCount[i] = leftSum;
+				leftBounds.Grow(bins[i].bounds);
+				leftArea[i] = leftSum > 0 ? leftBounds.HalfArea() : 0.f;
+
+				rightSum += bins[m_BinCount - 1 - i].count;
+				rightCount[m_BinCount - 2 - i] = rightSum;
+				rightBounds.Grow(bins[m_BinCount - 1 - i].bounds);
+				rightArea[m_BinCount - 2 - i] = rightSum > 0 ? rightBounds.HalfArea() : 0.f;
+			}
+
+			for (uint32_t i{ 0 }; i < m_BinCount - 1; ++i)
+			{
+				if (leftCount[i] == 0 || rightCount[i] == 0)
+					continue;
+
+				const float cost{ m_IntersectionCost * (leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i]) };
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = i;
+				}
+			}
+		}
+
+		const AABB nodeBounds{ node.minAABB, node.maxAABB };
+		return m_TraversalCost * nodeBounds.HalfArea() + bestCost;
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+#include <cstdint>
+#include <cfloat>
+#include <future>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Math.h"
+#include "SharedArray.h"
+
+namespace dae
+{
+#pragma region AABB
+	struct AABB
+	{
+		Vector3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow(const Vector3& point)
+		{
+			min = Vector3::Min(min, point);
+			max = Vector3::Max(max, point);
+		}
+
+		void Grow(const AABB& other)
+		{
+			min = Vector3::Min(min, other.min);
+			max = Vector3::Max(max, other.max);
+		}
+
+		//Half of the surface area, only used relative to other areas (SAH)
+		float HalfArea() const
+		{
+			const Vector3 extent{ max - min };
+			return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+		}
+
+		Vector3 Center() const
+		{
+			return (min + max) * 0.5f;
+		}
+
+		//Bounds of all 8 transformed corners
+		AABB Transform(const Matrix& transform) const
+		{
+			if (min.x > max.x)
+				return *this;
+
+			AABB transformed{};
+			for (int corner{ 0 }; corner < 8; ++corner)
+			{
+				transformed.Grow(transform.TransformPoint(
+					(corner & 1) ? max.x : min.x,
+					(corner & 2) ? max.y : min.y,
+					(corner & 4) ? max.z : min.z));
+			}
+			return transformed;
+		}
+	};
+#pragma endregion
+
+#pragma region BVH
+	//32 bytes, two nodes per cache line
+	//Interior node: leftFirst = index of left child (right child is leftFirst + 1), primitiveCount = 0
+	//Leaf node: leftFirst = first entry in the primitive index list, primitiveCount = number of entries
+	struct BVHNode
+	{
+		Vector3 minAABB{};
+		uint32_t leftFirst{};
+		Vector3 maxAABB{};
+		uint32_t primitiveCount{};
+
+		bool IsLeaf() const { return primitiveCount > 0; }
+	};
+
+	//4-wide node collapsed from the binary tree, 128 bytes (two cache lines)
+	//Child bounds are stored per axis so one SIMD sequence tests the ray against all four children
+	//Unused slots have inverted bounds, which a sign-ordered slab test never hits
+	struct alignas(64) BVH4Node
+	{
+		//minX, minY, minZ, maxX, maxY, maxZ, each for the 4 children
+		float bounds[6][4];
+		//Interior child: index of its BVH4Node, leaf child: first entry in the primitive index list
+		uint32_t child[4];
+		//0 for interior children, number of primitives for leaf children
+		uint32_t primitiveCount[4];
+	};
+
+	//Bounding Volume Hierarchy built with a binned Surface Area Heuristic
+	//The BVH only knows the bounds of its primitives, the owner maps primitive indices back to its own geometry
+	class BVH final
+	{
+	public:
+		//Maximum depth of the tree, traversal stacks can be sized with this
+		static constexpr uint32_t MaxDepth{ 64 };
+
+		BVH() = default;
+		~BVH() = default;
+
+		BVH(const BVH&) = delete;
+		BVH(BVH&&) noexcept = default;
+		BVH& operator=(const BVH&) = delete;
+		BVH& operator=(BVH&&) noexcept = default;
+
+		void Build(const std::vector<AABB>& primitiveBounds);
+		//Leaves with more primitives are split even when the SAH prefers a leaf, so owners can pack a leaf into one SIMD block
+		void SetMaxLeafSize(uint32_t maxLeafSize) { m_MaxLeafSize = maxLeafSize; }
+		//Keeps the topology and recomputes every node's bounds bottom-up, primitives must be the same ones used to build
+		void Refit(const std::vector<AABB>& primitiveBounds);
+		/**
+		 * \brief Keeps the tree valid for moving primitives without rebuilding it every frame
+		 * Builds when the primitive count changed, otherwise refits. Once refitting made the SAH cost grow past
+		 * RebuildCostRatio times the cost right after the last build, a rebuild is started on a background thread.
+		 * A finished background rebuild replaces the refitted tree on a later call.
+		 * \param primitiveBounds current bounds of every primitive
+		 */
+		void Update(const std::vector<AABB>& primitiveBounds);
+		/**
+		 * \brief Takes over a tree another BVH built, as returned by its GetNodes, GetWideNodes and GetPrimitiveIndices
+		 * Borrowed arrays are traversed in place, the first refit or rebuild copies them
+		 * \return false when the arrays do not form a valid tree, the BVH is left empty then
+		 */
+		bool Load(SharedArray<BVHNode>&& nodes, SharedArray<BVH4Node>&& wideNodes, SharedArray<uint32_t>&& primitiveIndices);
+		//For owners that moved their primitives into GetPrimitiveIndices order: entry k becomes primitive k,
+		//so the leaves address the owner's arrays directly and neighbouring leaves use neighbouring memory
+		void AdoptLeafOrder();
+		void Clear();
+
+		//SAH cost of the whole tree, relative to the area of the root
+		float CalculateCost() const;
+
+		bool IsEmpty() const { return m_Nodes.empty(); }
+		bool IsRebuilding() const { return m_Rebuild.valid(); }
+		std::span<const BVHNode> GetNodes() const { return m_Nodes; }
+		//Traversal layout, collapsed from the binary nodes after every build and refit
+		std::span<const BVH4Node> GetWideNodes() const { return m_WideNodes; }
+		std::span<const uint32_t> GetPrimitiveIndices() const { return m_PrimitiveIndices; }
+
+	private:
+		static constexpr uint32_t m_BinCount{ 16 };
+		static constexpr float m_TraversalCost{ 1.f };
+		static constexpr float m_IntersectionCost{ 1.f };
+		static constexpr float m_RebuildCostRatio{ 1.3f };
+
+		SharedArray<BVHNode> m_Nodes{};
+		SharedArray<BVH4Node> m_WideNodes{};
+		SharedArray<uint32_t> m_PrimitiveIndices{};
+		uint32_t m_NodesUsed{};
+		uint32_t m_MaxLeafSize{ UINT32_MAX };
+
+		float m_BuildCost{};
+		std::future<std::unique_ptr<BVH>> m_Rebuild{};
+
+		void UpdateNodeBounds(uint32_t nodeIndex, const std::vector<AABB>& primitiveBounds);
+		void Collapse();
+		uint32_t CollapseNode(uint32_t nodeIndex);
+		void Subdivide(uint32_t nodeIndex, uint32_t depth, const std::vector<AABB>& primitiveBounds, const std::vector<Vector3>& centroids);
+		float FindBestSplit(const BVHNode& node, const std::vector<AABB>& primitiveBounds, const std::vector<Vector3>& centroids,
+			int& bestAxis, uint32_t& bestBin, AABB& centroidBounds) const;
+	};
+#pragma endregion
+}
@@ -0,0 +1,312 @@
+//Headless batch renderer: renders a fixed amount of frames of one scene without a window and reports the throughput
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Project includes
+#include "Timer.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "CameraRecording.h"
+#include "Trace.h"
+
+using namespace dae;
+
+struct BatchSettings
+{
+	std::string sceneName{ "W4_Reference" };
+	int width{ 640 };
+	int height{ 480 };
+	//0 renders one frame, or every frame of the replay
+	int frameCount{ 0 };
+	uint32_t threadCount{ 0 };
+	//Output file per frame, a run of # is replaced by the zero padded frame number, empty writes no images
+	std::string outputPattern{};
+	//Like outputPattern, for the pixel costs as float PFM files, one file per cost channel, empty collects no costs
+	std::string costPattern{};
+	//Simulated seconds per frame passed to Scene::Update, 0 uses the replay's timestep or 1/30
+	float timeStep{ 0.f };
+	//Camera recording that drives the camera, empty keeps the camera still
+	std::string replayPath{};
+	//Chrome trace JSON of every frame, empty records no trace
+	std::string tracePath{};
+	//Snapshot of the initialized scene, empty writes none
+	std::string snapshotPath{};
+};
+
+void PrintUsage()
+{
+	std::cout << "Usage: RayTracerBatch [options]\n"
+		<< "  --scene <name>      scene to render (default W4_Reference)\n"
+		<< "  --width <pixels>    image width (default 640)\n"
+		<< "  --height <pixels>   image height (default 480)\n"
+		<< "  --frames <count>    frames to render (default 1, or the length of the replay)\n"
+		<< "  --threads <count>   render threads, 0 uses every hardware thread (default 0)\n"
+		<< "  --out <pattern>     BMP file per frame, # characters become the frame number (e.g. frame_####.bmp)\n"
+		<< "  --costs <pattern>   float PFM files per frame with the pixel costs, the channel name is added before the extension\n"
+		<< "  --timestep <sec>    simulated time between frames (default 0.0333, or the timestep of the replay)\n"
+		<< "  --replay <file>     camera recording to replay, recorded in the viewer with F6\n"
+		<< "  --trace <file>      Chrome trace JSON of the frames, open it in chrome://tracing or Perfetto\n"
+		<< "  --snapshot <file>   binary snapshot of the initialized scene, render it again with --scene <file>.rtscene\n"
+		<< "Scenes:";
+	for (const std::string& sceneName : GetSceneNames())
+	{
+		std::cout << ' ' << sceneName;
+	}
+	std::cout << " Spheres_<N> Triangles_<N> Lights_<N> <file>.scene <file>.rtscene\n";
+}
+
+bool ParseArguments(int argc, char* args[], BatchSettings& settings)
+{
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ args[i] };
+		if (argument == "--help" || argument == "-h")
+			return false;
+
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << argument << '\n';
+			return false;
+		}
+
+		const std::string value{ args[++i] };
+		char* pEnd{};
+		if (argument == "--scene")
+			settings.sceneName = value;
+		else if (argument == "--out")
+			settings.outputPattern = value;
+		else if (argument == "--costs")
+			settings.costPattern = value;
+		else if (argument == "--replay")
+			settings.replayPath = value;
+		else if (argument == "--trace")
+			settings.tracePath = value;
+		else if (argument == "--snapshot")
+			settings.snapshotPath = value;
+		else if (argument == "--width")
+			settings.width = static_cast<int>(std::strtol(value.c_str(), &pEnd, 10));
+		else if (argument == "--height")
+			settings.height = static_cast<int>(std::strtol(value.c_str(), &pEnd, 10));
+		else if (argument == "--frames")
+			settings.frameCount = static_cast<int>(std::strtol(value.c_str(), &pEnd, 10));
+		else if (argument == "--threads")
+			settings.threadCount = static_cast<uint32_t>(std::strtoul(value.c_str(), &pEnd, 10));
+		else if (argument == "--timestep")
+			settings.timeStep = std::strtof(value.c_str(), &pEnd);
+		else
+		{
+			std::cerr << "Unknown option " << argument << '\n';
+			return false;
+		}
+
+		if (pEnd && *pEnd != '\0')
+		{
+			std::cerr << "Invalid value for " << argument << ": " << value << '\n';
+			return false;
+		}
+	}
+
+	if (settings.width <= 0 || settings.height <= 0 || settings.frameCount < 0 || settings.timeStep < 0.f)
+	{
+		std::cerr << "Width and height have to be positive, frames and timestep can not be negative\n";
+		return false;
+	}
+	return true;
+}
+
+std::string GetOutputPath(const std::string& pattern, int frame, int frameCount)
+{
+	const size_t lastHash{ pattern.rfind('#') };
+	if (lastHash == std::string::npos)
+	{
+		if (frameCount == 1)
+			return pattern;
+
+		//Without a # every frame gets a number in front of the extension
+		const size_t extension{ pattern.rfind('.') };
+		const size_t insertAt{ extension == std::string::npos ? pattern.size() : extension };
+		std::string frameNumber{ std::to_string(frame) };
+		frameNumber.insert(0, frameNumber.size() < 4 ? 4 - frameNumber.size() : 0, '0');
+		return pattern.substr(0, insertAt) + '_' + frameNumber + pattern.substr(insertAt);
+	}
+
+	size_t firstHash{ lastHash };
+	while (firstHash > 0 && pattern[firstHash - 1] == '#')
+	{
+		--firstHash;
+	}
+
+	const size_t digits{ lastHash - firstHash + 1 };
+	std::string frameNumber{ std::to_string(frame) };
+	frameNumber.insert(0, frameNumber.size() < digits ? digits - frameNumber.size() : 0, '0');
+	return pattern.substr(0, firstHash) + frameNumber + pattern.substr(lastHash + 1);
+}
+
+//Writes every cost channel to its own file, named after filePath with the channel inserted before the extension
+void SavePixelCosts(const Renderer& renderer, const std::string& filePath)
+{
+	const std::pair<Renderer::CostChannel, const char*> channels[]{
+		{ Renderer::CostChannel::NodeVisits, "_nodes" },
+		{ Renderer::CostChannel::PrimitiveTests, "_tests" },
+		{ Renderer::CostChannel::ShadowRays, "_shadowrays" },
+		{ Renderer::CostChannel::ShadingTime, "_shadingns" } };
+
+	const size_t extension{ filePath.rfind('.') };
+	const size_t insertAt{ extension == std::string::npos || extension < filePath.find_last_of("/\\") + 1 ? filePath.size() : extension };
+
+	for (const auto& [channel, pSuffix] : channels)
+	{
+		if (!Renderer::IsCostChannelAvailable(channel))
+			continue;
+
+		const std::string channelPath{ filePath.substr(0, insertAt) + pSuffix + filePath.substr(insertAt) };
+		if (!renderer.SavePixelCostsToImage(channel, channelPath))
+			std::cerr << "Could not write " << channelPath << '\n';
+	}
+}
+
+int main(int argc, char* args[])
+{
+	BatchSettings settings{};
+	if (!ParseArguments(argc, args, settings))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::unique_ptr<Scene> pScene{ CreateScene(settings.sceneName) };
+	if (!pScene)
+	{
+		std::cerr << "Unknown scene " << settings.sceneName << '\n';
+		PrintUsage();
+		return 1;
+	}
+	//Setup includes the acceleration structures, which is what a snapshot saves
+	const auto setupStartTime = std::chrono::steady_clock::now();
+	pScene->Initialize();
+	pScene->UpdateAccelerationStructure();
+	const double setupTime{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - setupStartTime).count() };
+	std::cout << "Scene setup took " << std::fixed << std::setprecision(2) << setupTime << " ms\n";
+
+	if (!settings.snapshotPath.empty() && !pScene->SaveSnapshot(settings.snapshotPath))
+		std::cerr << "Could not write " << settings.snapshotPath << '\n';
+
+	if (!settings.costPattern.empty() && !Renderer::IsCostChannelAvailable(Renderer::CostChannel::NodeVisits))
+		std::cout << "Node visits and primitive tests need RAYTRACER_ENABLE_STATS, --costs only writes shadow rays and shading time\n";
+
+	CameraRecording replay{};
+	if (!settings.replayPath.empty())
+	{
+		if (!replay.LoadFromFile(settings.replayPath))
+		{
+			std::cerr << "Could not load camera recording " << settings.replayPath << '\n';
+			return 1;
+		}
+		if (settings.frameCount == 0)
+			settings.frameCount = static_cast<int>(replay.GetFrameCount());
+		if (settings.timeStep == 0.f)
+			settings.timeStep = replay.GetTimeStep();
+	}
+	if (settings.frameCount == 0)
+		settings.frameCount = 1;
+	if (settings.timeStep == 0.f)
+		settings.timeStep = 1.f / 30.f;
+
+	std::vector<uint32_t> pixels(size_t(settings.width) * settings.height);
+	Renderer renderer{ pixels.data(), settings.width, settings.height, settings.threadCount };
+	renderer.SetCostCollectionEnabled(!settings.costPattern.empty());
+
+	Timer timer{};
+	timer.SetFixedTimeStep(settings.timeStep);
+	timer.Start();
+
+	std::cout << "Rendering " << settings.frameCount << " frame(s) of " << settings.sceneName << " at "
+		<< settings.width << 'x' << settings.height << " on " << renderer.GetThreadCount() << " thread(s)\n";
+
+	std::vector<double> frameTimes{};
+	std::vector<uint64_t> frameRayCounts{};
+	StatBlock totalStats{};
+	frameTimes.reserve(settings.frameCount);
+	frameRayCounts.reserve(settings.frameCount);
+
+	Trace::SetThreadName("Main");
+	Trace::SetEnabled(!settings.tracePath.empty());
+
+	for (int frame{ 0 }; frame < settings.frameCount; ++frame)
+	{
+		const TraceScope frameScope{ "Frame", frame };
+
+		pScene->SetCameraInput(replay.GetInput(frame));
+		{
+			const TraceScope traceScope{ "Scene::Update" };
+			pScene->Update(&timer);
+		}
+
+		const auto startTime = std::chrono::steady_clock::now();
+		renderer.Render(pScene.get());
+		const auto endTime = std::chrono::steady_clock::now();
+
+		frameTimes.push_back(std::chrono::duration<double>(endTime - startTime).count());
+		frameRayCounts.push_back(renderer.GetRayCount());
+		totalStats += renderer.GetStats();
+
+		if (!settings.outputPattern.empty())
+		{
+			const TraceScope traceScope{ "Renderer::SaveBufferToImage" };
+			const std::string outputPath{ GetOutputPath(settings.outputPattern, frame, settings.frameCount) };
+			if (!renderer.SaveBufferToImage(outputPath))
+				std::cerr << "Could not write " << outputPath << '\n';
+		}
+		if (!settings.costPattern.empty())
+			SavePixelCosts(renderer, GetOutputPath(settings.costPattern, frame, settings.frameCount));
+
+		timer.Update();
+	}
+	timer.Stop();
+
+	if (!settings.tracePath.empty())
+	{
+		Trace::SetEnabled(false);
+		if (!Trace::SaveToFile(settings.tracePath))
+			std::cerr << "Could not write " << settings.tracePath << '\n';
+	}
+
+	//Timing report
+	double totalTime{ 0.0 };
+	uint64_t totalRayCount{ 0 };
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "frame    time (ms)        rays   Mrays/s\n";
+	for (int frame{ 0 }; frame < settings.frameCount; ++frame)
+	{
+		totalTime += frameTimes[frame];
+		totalRayCount += frameRayCounts[frame];
+		std::cout << std::setw(5) << frame
+			<< std::setw(13) << frameTimes[frame] * 1000.0
+			<< std::setw(12) << frameRayCounts[frame]
+			<< std::setw(10) << frameRayCounts[frame] / frameTimes[frame] / 1e6 << '\n';
+	}
+	std::cout << "total " << totalTime * 1000.0 << " ms, " << totalTime * 1000.0 / settings.frameCount << " ms/frame, "
+		<< totalRayCount << " rays, " << totalRayCount / totalTime / 1e6 << " Mrays/s\n";
+
+#if RAYTRACER_ENABLE_STATS
+	const uint64_t tracedRayCount{ std::max<uint64_t>(totalStats[StatCounter::PrimaryRays] + totalStats[StatCounter::ShadowRays], 1) };
+	std::cout << "stats " << totalStats[StatCounter::PrimaryRays] << " primary rays, "
+		<< totalStats[StatCounter::ShadowRays] << " shadow rays, "
+		<< totalStats[StatCounter::NodeVisits] << " node visits (" << double(totalStats[StatCounter::NodeVisits]) / tracedRayCount << " per ray), "
+		<< totalStats[StatCounter::PrimitiveTests] << " primitive tests (" << double(totalStats[StatCounter::PrimitiveTests]) / tracedRayCount << " per ray), "
+		<< totalStats[StatCounter::ShadingCalls] << " shading calls\n";
+#else
+	std::cout << "stats disabled, build with RAYTRACER_ENABLE_STATS for ray, node visit, primitive test and shading call counts\n";
+#endif
+
+	return 0;
+}
@@ -0,0 +1,428 @@
+//Scene benchmark: renders every scene at a fixed resolution for several thread counts and reports frame times,
+//ray throughput and strong-scaling efficiency as JSON, so results can be compared across versions and machines
+//The report also lists what the mesh import optimization saves on the OBJ files, in memory and in simulated cache misses
+
+//Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Project includes
+#include "Timer.h"
+#include "Json.h"
+#include "MeshOptimizer.h"
+#include "OBJParser.h"
+#include "Renderer.h"
+#include "Scene.h"
+
+using namespace dae;
+
+struct BenchmarkSettings
+{
+	int width{ 640 };
+	int height{ 480 };
+	//Measured frames per scene and thread count, after the warmup frames
+	int frameCount{ 10 };
+	int warmupCount{ 2 };
+	std::vector<uint32_t> threadCounts{};
+	std::vector<std::string> sceneNames{};
+	std::vector<std::string> meshPaths{ "Resources/lowpoly_bunny.obj", "Resources/simple_object.obj", "Resources/simple_cube.obj" };
+	//JSON report file, empty writes the report to stdout
+	std::string outputPath{};
+};
+
+struct BenchmarkResult
+{
+	std::string sceneName{};
+	uint32_t threadCount{};
+	double medianTime{};
+	double p95Time{};
+	double meanTime{};
+	double primaryRaysPerSecond{};
+	double shadowRaysPerSecond{};
+	//Speedup over the smallest thread count divided by the increase in threads, 1 is perfect scaling
+	double scalingEfficiency{};
+};
+
+struct MeshResult
+{
+	std::string filePath{};
+	//"file" keeps the vertices as the OBJ shares them, "appended" gives every triangle its own three like TriangleMesh::AppendTriangle
+	std::string layout{};
+	size_t triangleCount{};
+	size_t vertexCountBefore{};
+	size_t vertexCountAfter{};
+	size_t bytesBefore{};
+	size_t bytesAfter{};
+	//Simulated L1 misses of the vertex and normal fetches in BVH leaf order, the order triangle blocks are gathered in
+	uint64_t cacheMissesBefore{};
+	uint64_t cacheMissesAfter{};
+	double optimizeTime{};
+};
+
+void PrintUsage()
+{
+	std::cerr << "Usage: RayTracerBenchmark [options]\n"
+		<< "  --width <pixels>    image width (default 640)\n"
+		<< "  --height <pixels>   image height (default 480)\n"
+		<< "  --frames <count>    measured frames per run (default 10)\n"
+		<< "  --warmup <count>    unmeasured frames before every run (default 2)\n"
+		<< "  --threads <list>    comma separated thread counts (default 1, 2, 4, ... up to every hardware thread)\n"
+		<< "  --scenes <list>     comma separated scene names or .scene files (default every week scene and the scaling scenes)\n"
+		<< "  --meshes <list>     comma separated OBJ files for the mesh import report (default the OBJ files in Resources)\n"
+		<< "  --out <file>        JSON report file (default stdout)\n";
+}
+
+std::vector<std::string> SplitList(const std::string& list)
+{
+	std::vector<std::string> items{};
+	std::stringstream stream{ list };
+	std::string item{};
+	while (std::getline(stream, item, ','))
+	{
+		if (!item.empty())
+			items.push_back(item);
+	}
+	return items;
+}
+
+bool ParseArguments(int argc, char* args[], BenchmarkSettings& settings)
+{
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ args[i] };
+		if (argument == "--help" || argument == "-h")
+			return false;
+
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Missing value for " << argument << '\n';
+			return false;
+		}
+
+		const std::string value{ args[++i] };
+		char* pEnd{};
+		if (argument == "--width")
+			settings.width = static_cast<int>(std::strtol(value.c_str(), &pEnd, 10));
+		else if (argument == "--height")
+			settings.height = static_cast<int>(std::strtol(value.c_str(), &pEnd, 10));
+		else if (argument == "--frames")
+			settings.frameCount = static_cast<int>(std::strtol(value.c_str(), &pEnd, 10));
+		else if (argument == "--warmup")
+			settings.warmupCount = static_cast<int>(std::strtol(value.c_str(), &pEnd, 10));
+		else if (argument == "--scenes")
+			settings.sceneNames = SplitList(value);
+		else if (argument == "--meshes")
+			settings.meshPaths = SplitList(value);
+		else if (argument == "--out")
+			settings.outputPath = value;
+		else if (argument == "--threads")
+		{
+			settings.threadCounts.clear();
+			for (const std::string& item : SplitList(value))
+			{
+				settings.threadCounts.push_back(static_cast<uint32_t>(std::strtoul(item.c_str(), &pEnd, 10)));
+				if (*pEnd != '\0')
+				{
+					std::cerr << "Invalid value for " << argument << ": " << value << '\n';
+					return false;
+				}
+			}
+			//pEnd pointed into the items, which are gone now
+			pEnd = nullptr;
+		}
+		else
+		{
+			std::cerr << "Unknown option " << argument << '\n';
+			return false;
+		}
+
+		if (pEnd && *pEnd != '\0')
+		{
+			std::cerr << "Invalid value for " << argument << ": " << value << '\n';
+			return false;
+		}
+	}
+
+	if (settings.width <= 0 || settings.height <= 0 || settings.frameCount <= 0 || settings.warmupCount < 0)
+	{
+		std::cerr << "Width, height and frames have to be positive, warmup can not be negative\n";
+		return false;
+	}
+	if (std::find(settings.threadCounts.begin(), settings.threadCounts.end(), 0u) != settings.threadCounts.end())
+	{
+		std::cerr << "Thread counts have to be positive\n";
+		return false;
+	}
+	return true;
+}
+
+std::vector<uint32_t> GetDefaultThreadCounts()
+{
+	const uint32_t hardwareThreads{ std::max(std::thread::hardware_concurrency(), 1u) };
+
+	std::vector<uint32_t> threadCounts{};
+	for (uint32_t threadCount{ 1 }; threadCount < hardwareThreads; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(hardwareThreads);
+	return threadCounts;
+}
+
+std::vector<std::string> GetDefaultSceneNames()
+{
+	std::vector<std::string> sceneNames{ GetSceneNames() };
+	for (const char* pScaling : { "Spheres_16", "Spheres_256", "Spheres_4096",
+		"Triangles_1024", "Triangles_16384", "Triangles_262144",
+		"Lights_1", "Lights_4", "Lights_16" })
+	{
+		sceneNames.emplace_back(pScaling);
+	}
+	return sceneNames;
+}
+
+BenchmarkResult RunBenchmark(Scene* pScene, const std::string& sceneName, uint32_t threadCount, const BenchmarkSettings& settings)
+{
+	std::vector<uint32_t> pixels(size_t(settings.width) * settings.height);
+	Renderer renderer{ pixels.data(), settings.width, settings.height, threadCount };
+
+	//Every run animates through the same simulated frames
+	Timer timer{};
+	timer.SetFixedTimeStep(1.f / 30.f);
+	timer.Start();
+
+	std::vector<double> frameTimes{};
+	uint64_t rayCount{ 0 };
+	uint64_t primaryRayCount{ 0 };
+	for (int frame{ 0 }; frame < settings.warmupCount + settings.frameCount; ++frame)
+	{
+		pScene->Update(&timer);
+
+		const auto startTime = std::chrono::steady_clock::now();
+		renderer.Render(pScene);
+		const auto endTime = std::chrono::steady_clock::now();
+
+		if (frame >= settings.warmupCount)
+		{
+			frameTimes.push_back(std::chrono::duration<double>(endTime - startTime).count());
+			rayCount += renderer.GetRayCount();
+			primaryRayCount += renderer.GetPrimaryRayCount();
+		}
+
+		timer.Update();
+	}
+	timer.Stop();
+
+	BenchmarkResult result{};
+	result.sceneName = sceneName;
+	result.threadCount = threadCount;
+
+	double totalTime{ 0.0 };
+	for (double frameTime : frameTimes)
+	{
+		totalTime += frameTime;
+	}
+	result.meanTime = totalTime / frameTimes.size();
+	result.primaryRaysPerSecond = primaryRayCount / totalTime;
+	result.shadowRaysPerSecond = (rayCount - primaryRayCount) / totalTime;
+
+	//Nearest rank percentiles
+	std::sort(frameTimes.begin(), frameTimes.end());
+	const size_t frameCount{ frameTimes.size() };
+	result.medianTime = (frameCount % 2) ? frameTimes[frameCount / 2] : (frameTimes[frameCount / 2 - 1] + frameTimes[frameCount / 2]) * 0.5;
+	result.p95Time = frameTimes[std::min(static_cast<size_t>(std::ceil(frameCount * 0.95)), frameCount) - 1];
+	return result;
+}
+
+size_t GetMeshBytes(const MeshGeometry& geometry)
+{
+	return geometry.positions.size() * sizeof(Vector3) + geometry.normals.size() * sizeof(Vector3) + geometry.indices.size() * sizeof(int);
+}
+
+MeshResult RunMeshBenchmark(const std::string& filePath, const std::string& layout, MeshGeometry& geometry)
+{
+	MeshResult result{};
+	result.filePath = filePath;
+	result.layout = layout;
+	result.triangleCount = geometry.indices.size() / 3;
+	result.vertexCountBefore = geometry.positions.size();
+	result.bytesBefore = GetMeshBytes(geometry);
+
+	//The BVH as it was built before the optimization, over the triangles in file order
+	std::vector<AABB> triangleBounds(result.triangleCount);
+	for (size_t i{ 0 }; i < result.triangleCount; ++i)
+	{
+		for (int corner{ 0 }; corner < 3; ++corner)
+		{
+			triangleBounds[i].Grow(geometry.positions[geometry.indices[i * 3 + corner]]);
+		}
+	}
+	BVH fileOrderBVH{};
+	fileOrderBVH.SetMaxLeafSize(TriangleSoA::BlockSize);
+	fileOrderBVH.Build(triangleBounds);
+	result.cacheMissesBefore = MeshOptimizer::CountCacheMisses(geometry.positions, geometry.normals, geometry.indices, fileOrderBVH.GetPrimitiveIndices());
+
+	const auto startTime = std::chrono::steady_clock::now();
+	MeshOptimizer::Optimize(geometry.positions.Edit(), geometry.normals.Edit(), geometry.indices.Edit());
+	const auto endTime = std::chrono::steady_clock::now();
+	result.optimizeTime = std::chrono::duration<double>(endTime - startTime).count();
+
+	geometry.BuildBVH();
+	result.vertexCountAfter = geometry.positions.size();
+	result.bytesAfter = GetMeshBytes(geometry);
+	result.cacheMissesAfter = MeshOptimizer::CountCacheMisses(geometry.positions, geometry.normals, geometry.indices, geometry.bvh.GetPrimitiveIndices());
+	return result;
+}
+
+void WriteReport(std::ostream& output, const BenchmarkSettings& settings, const std::vector<BenchmarkResult>& results,
+	const std::vector<MeshResult>& meshResults)
+{
+	output << std::fixed << std::setprecision(4);
+	output << "{\n"
+		<< "  \"width\": " << settings.width << ",\n"
+		<< "  \"height\": " << settings.height << ",\n"
+		<< "  \"frames\": " << settings.frameCount << ",\n"
+		<< "  \"warmupFrames\": " << settings.warmupCount << ",\n"
+		<< "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n"
+		<< "  \"results\": [\n";
+
+	for (size_t i{ 0 }; i < results.size(); ++i)
+	{
+		const BenchmarkResult& result = results[i];
+		output << "    {"
+			<< " \"scene\": \"";
+		Json::WriteEscaped(output, result.sceneName);
+		output << "\","
+			<< " \"threads\": " << result.threadCount << ","
+			<< " \"medianMs\": " << result.medianTime * 1000.0 << ","
+			<< " \"p95Ms\": " << result.p95Time * 1000.0 << ","
+			<< " \"meanMs\": " << result.meanTime * 1000.0 << ","
+			<< " \"primaryRaysPerSecond\": " << result.primaryRaysPerSecond << ","
+			<< " \"shadowRaysPerSecond\": " << result.shadowRaysPerSecond << ","
+			<< " \"scalingEfficiency\": " << result.scalingEfficiency
+			<< " }" << (i + 1 < results.size() ? "," : "") << '\n';
+	}
+
+	output << "  ],\n"
+		<< "  \"meshes\": [\n";
+
+	for (size_t i{ 0 }; i < meshResults.size(); ++i)
+	{
+		const MeshResult& result = meshResults[i];
+		output << "    {"
+			<< " \"file\": \"";
+		Json::WriteEscaped(output, result.filePath);
+		output << "\","
+			<< " \"layout\": \"" << result.layout << "\","
+			<< " \"triangles\": " << result.triangleCount << ","
+			<< " \"verticesBefore\": " << result.vertexCountBefore << ","
+			<< " \"verticesAfter\": " << result.vertexCountAfter << ","
+			<< " \"bytesBefore\": " << result.bytesBefore << ","
+			<< " \"bytesAfter\": " << result.bytesAfter << ","
+			<< " \"cacheMissesBefore\": " << result.cacheMissesBefore << ","
+			<< " \"cacheMissesAfter\": " << result.cacheMissesAfter << ","
+			<< " \"optimizeMs\": " << result.optimizeTime * 1000.0
+			<< " }" << (i + 1 < meshResults.size() ? "," : "") << '\n';
+	}
+
+	output << "  ]\n"
+		<< "}\n";
+}
+
+int main(int argc, char* args[])
+{
+	BenchmarkSettings settings{};
+	if (!ParseArguments(argc, args, settings))
+	{
+		PrintUsage();
+		return 1;
+	}
+	if (settings.threadCounts.empty())
+		settings.threadCounts = GetDefaultThreadCounts();
+	if (settings.sceneNames.empty())
+		settings.sceneNames = GetDefaultSceneNames();
+
+	std::sort(settings.threadCounts.begin(), settings.threadCounts.end());
+	settings.threadCounts.erase(std::unique(settings.threadCounts.begin(), settings.threadCounts.end()), settings.threadCounts.end());
+
+	std::vector<BenchmarkResult> results{};
+	for (const std::string& sceneName : settings.sceneNames)
+	{
+		const std::unique_ptr<Scene> pScene{ CreateScene(sceneName) };
+		if (!pScene)
+		{
+			std::cerr << "Unknown scene " << sceneName << ", skipped\n";
+			continue;
+		}
+		pScene->Initialize();
+
+		const size_t firstResult{ results.size() };
+		for (uint32_t threadCount : settings.threadCounts)
+		{
+			results.push_back(RunBenchmark(pScene.get(), sceneName, threadCount, settings));
+
+			//Strong scaling against the smallest thread count of this scene
+			const BenchmarkResult& baseline = results[firstResult];
+			BenchmarkResult& result = results.back();
+			result.scalingEfficiency = (baseline.medianTime * baseline.threadCount) / (result.medianTime * result.threadCount);
+
+			std::cerr << std::fixed << std::setprecision(2) << sceneName << " x" << threadCount
+				<< ": median " << result.medianTime * 1000.0 << " ms, p95 " << result.p95Time * 1000.0 << " ms, "
+				<< (result.primaryRaysPerSecond + result.shadowRaysPerSecond) / 1e6 << " Mrays/s\n";
+		}
+	}
+
+	std::vector<MeshResult> meshResults{};
+	for (const std::string& meshPath : settings.meshPaths)
+	{
+		MeshGeometry geometry{};
+		if (!Utils::ParseOBJ(meshPath, geometry.positions.Edit(), geometry.normals.Edit(), geometry.indices.Edit()))
+		{
+			std::cerr << "Could not load mesh " << meshPath << ", skipped\n";
+			continue;
+		}
+
+		MeshGeometry appendedGeometry{};
+		appendedGeometry.normals = geometry.normals;
+		for (const int index : geometry.indices)
+		{
+			appendedGeometry.indices.Edit().push_back(static_cast<int>(appendedGeometry.positions.size()));
+			appendedGeometry.positions.Edit().push_back(geometry.positions[index]);
+		}
+
+		meshResults.push_back(RunMeshBenchmark(meshPath, "file", geometry));
+		meshResults.push_back(RunMeshBenchmark(meshPath, "appended", appendedGeometry));
+		for (const MeshResult& result : { meshResults[meshResults.size() - 2], meshResults.back() })
+		{
+			std::cerr << std::fixed << std::setprecision(2) << meshPath << " (" << result.layout << "): "
+				<< result.vertexCountBefore << " -> " << result.vertexCountAfter << " vertices, "
+				<< (static_cast<double>(result.bytesBefore) - static_cast<double>(result.bytesAfter)) / 1024.0 << " KB saved, "
+				<< result.cacheMissesBefore << " -> " << result.cacheMissesAfter << " simulated cache misses\n";
+		}
+	}
+
+	if (settings.outputPath.empty())
+	{
+		WriteReport(std::cout, settings, results, meshResults);
+		return 0;
+	}
+
+	std::ofstream file{ settings.outputPath };
+	WriteReport(file, settings, results, meshResults);
+	if (!file)
+	{
+		std::cerr << "Could not write " << settings.outputPath << '\n';
+		return 1;
+	}
+	return 0;
+}
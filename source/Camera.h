@@ -1,7 +1,5 @@
 #pragma once
 #include <cassert>
-#include <SDL_keyboard.h>
-#include <SDL_mouse.h>
 
 #include "Math.h"
 #include "Timer.h"
@@ -9,6 +7,20 @@
 
 namespace dae
 {
+	//Input state of one frame, filled in by the frontend so the camera does not depend on a windowing library
+	struct CameraInput
+	{
+		bool moveForward{};
+		bool moveBackward{};
+		bool moveLeft{};
+		bool moveRight{};
+
+		//Rotation only follows the mouse while rotating (right mouse button in the viewer)
+		bool isRotating{};
+		int mouseDeltaX{};
+		int mouseDeltaY{};
+	};
+
 	struct Camera
 	{
 		Camera() = default;
@@ -47,41 +59,38 @@ namespace dae
 			return cameraToWorld;
 		}
 
-		void Update(Timer* pTimer)
+		void Update(const CameraInput& input, Timer* pTimer)
 		{
 			const float deltaTime = pTimer->GetElapsed();
 
 			//Keyboard Input
-			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
 			const float moveSpeed{ 5.f };
 
-			if (pKeyboardState[SDL_SCANCODE_W])
+			if (input.moveForward)
 			{
 				origin += forward * moveSpeed * deltaTime;
 			}
-			if (pKeyboardState[SDL_SCANCODE_S])
+			if (input.moveBackward)
 			{
 				origin -= forward * moveSpeed * deltaTime;
 			}
-			if (pKeyboardState[SDL_SCANCODE_A])
+			if (input.moveLeft)
 			{
 				origin -= right * moveSpeed * deltaTime;
 			}
-			if (pKeyboardState[SDL_SCANCODE_D])
+			if (input.moveRight)
 			{
 				origin += right * moveSpeed * deltaTime;
 			}
 
 
 			//Mouse Input
-			int mouseX{}, mouseY{};
-			const uint32_t mouseState = SDL_GetRelativeMouseState(&mouseX, &mouseY);
 			const float rotationSpeed{ 5.f };
 
-			if (mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT))
+			if (input.isRotating)
 			{
-				totalPitch = mouseY * rotationSpeed * deltaTime;
-				totalYaw = mouseX * rotationSpeed * deltaTime;
+				totalPitch = input.mouseDeltaY * rotationSpeed * deltaTime;
+				totalYaw = input.mouseDeltaX * rotationSpeed * deltaTime;
 			}
 
 			//std::cout << totalYaw << '\n';
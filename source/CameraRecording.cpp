@@ -0,0 +1,133 @@
+#include "CameraRecording.h"
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+
+using namespace dae;
+
+//File layout, little endian:
+//"RTCI", uint32 version, uint32 frame count, float timestep
+//then per frame: uint8 flags (forward, backward, left, right, rotating), int16 mouse delta x, int16 mouse delta y
+static constexpr char g_FileMagic[4]{ 'R', 'T', 'C', 'I' };
+static constexpr uint32_t g_FileVersion{ 1 };
+
+enum InputFlags : uint8_t
+{
+	MoveForward = 1 << 0,
+	MoveBackward = 1 << 1,
+	MoveLeft = 1 << 2,
+	MoveRight = 1 << 3,
+	Rotating = 1 << 4
+};
+
+void CameraRecording::Record(const CameraInput& input, float deltaTime)
+{
+	m_Inputs.push_back(input);
+	m_RecordedTime += deltaTime;
+	if (m_RecordedTime > 0.0)
+		m_TimeStep = static_cast<float>(m_RecordedTime / m_Inputs.size());
+}
+
+void CameraRecording::Clear()
+{
+	m_Inputs.clear();
+	m_RecordedTime = 0.0;
+	m_TimeStep = 1.f / 30.f;
+}
+
+bool CameraRecording::SaveToFile(const std::string& filePath) const
+{
+	std::ofstream file{ filePath, std::ios::binary };
+	if (!file)
+		return false;
+
+	const auto write = [&file](uint32_t value, int byteCount)
+		{
+			for (int byte{ 0 }; byte < byteCount; ++byte)
+			{
+				file.put(static_cast<char>((value >> (byte * 8)) & 0xFF));
+			}
+		};
+	//Mouse deltas are pixels per frame, int16 is plenty
+	const auto clampDelta = [](int delta)
+		{
+			return static_cast<uint16_t>(static_cast<int16_t>(std::clamp(delta, -32768, 32767)));
+		};
+
+	file.write(g_FileMagic, sizeof(g_FileMagic));
+	write(g_FileVersion, 4);
+	write(GetFrameCount(), 4);
+	write(std::bit_cast<uint32_t>(m_TimeStep), 4);
+
+	for (const CameraInput& input : m_Inputs)
+	{
+		uint8_t flags{ 0 };
+		flags |= input.moveForward ? MoveForward : 0;
+		flags |= input.moveBackward ? MoveBackward : 0;
+		flags |= input.moveLeft ? MoveLeft : 0;
+		flags |= input.moveRight ? MoveRight : 0;
+		flags |= input.isRotating ? Rotating : 0;
+
+		write(flags, 1);
+		write(clampDelta(input.mouseDeltaX), 2);
+		write(clampDelta(input.mouseDeltaY), 2);
+	}
+
+	return file.good();
+}
+
+bool CameraRecording::LoadFromFile(const std::string& filePath)
+{
+	Clear();
+
+	std::ifstream file{ filePath, std::ios::binary };
+	if (!file)
+		return false;
+
+	const auto read = [&file](int byteCount)
+		{
+			uint32_t value{ 0 };
+			for (int byte{ 0 }; byte < byteCount; ++byte)
+			{
+				value |= static_cast<uint32_t>(static_cast<uint8_t>(file.get())) << (byte * 8);
+			}
+			return value;
+		};
+
+	char magic[4]{};
+	file.read(magic, sizeof(magic));
+	if (!std::equal(std::begin(magic), std::end(magic), std::begin(g_FileMagic)) || read(4) != g_FileVersion)
+		return false;
+
+	const uint32_t frameCount{ read(4) };
+	const float timeStep{ std::bit_cast<float>(read(4)) };
+	if (!file || !(timeStep > 0.f))
+		return false;
+
+	std::vector<CameraInput> inputs{};
+	//The count comes from the file, so only a sane amount is reserved up front
+	inputs.reserve(std::min(frameCount, 1u << 16));
+	for (uint32_t frame{ 0 }; frame < frameCount; ++frame)
+	{
+		const uint32_t flags{ read(1) };
+
+		CameraInput input{};
+		input.moveForward = flags & MoveForward;
+		input.moveBackward = flags & MoveBackward;
+		input.moveLeft = flags & MoveLeft;
+		input.moveRight = flags & MoveRight;
+		input.isRotating = flags & Rotating;
+		input.mouseDeltaX = static_cast<int16_t>(read(2));
+		input.mouseDeltaY = static_cast<int16_t>(read(2));
+		if (!file)
+			return false;
+
+		inputs.push_back(input);
+	}
+
+	m_Inputs = std::move(inputs);
+	m_TimeStep = timeStep;
+	m_RecordedTime = double(timeStep) * m_Inputs.size();
+	return true;
+}
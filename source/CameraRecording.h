@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+
+namespace dae
+{
+	//Camera input of a session, one CameraInput per frame, saved to a compact binary file
+	//Replaying it at a fixed timestep drives the camera through the same frames on every run
+	class CameraRecording final
+	{
+	public:
+		CameraRecording() = default;
+		~CameraRecording() = default;
+
+		CameraRecording(const CameraRecording&) = default;
+		CameraRecording(CameraRecording&&) noexcept = default;
+		CameraRecording& operator=(const CameraRecording&) = default;
+		CameraRecording& operator=(CameraRecording&&) noexcept = default;
+
+		/**
+		 * \brief Appends the input of one frame
+		 * \param input camera input of the frame
+		 * \param deltaTime seconds the frame took, averaged into the replay timestep
+		 */
+		void Record(const CameraInput& input, float deltaTime);
+		void Clear();
+
+		//Returns false when the file could not be written
+		bool SaveToFile(const std::string& filePath) const;
+		//Returns false when the file could not be read or is not a camera recording, the recording is left empty then
+		bool LoadFromFile(const std::string& filePath);
+
+		uint32_t GetFrameCount() const { return static_cast<uint32_t>(m_Inputs.size()); }
+		//Input of a recorded frame, frames past the end return no input so the camera stays put
+		CameraInput GetInput(uint32_t frame) const { return frame < m_Inputs.size() ? m_Inputs[frame] : CameraInput{}; }
+		//Average frame time of the recorded session, replays use it as their fixed timestep
+		float GetTimeStep() const { return m_TimeStep; }
+
+	private:
+		std::vector<CameraInput> m_Inputs{};
+		double m_RecordedTime{};
+		float m_TimeStep{ 1.f / 30.f };
+	};
+}
@@ -1,9 +1,16 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
 
 #include "Math.h"
+#include "BVH.h"
+#include "MeshOptimizer.h"
+#include "SharedArray.h"
+#include "SIMD.h"
 #include "vector"
 #include <iostream>
+#include <memory>
+#include <span>
 
 namespace dae
 {
@@ -55,6 +62,104 @@ namespace dae
 		unsigned char materialIndex{};
 	};
 
+	//Spheres in BVH leaf order, one array per component so a SIMD kernel tests a whole leaf at once
+	//BVH leaves are capped at BlockSize spheres, so every leaf [first, first + count) is a single block
+	struct SphereSoA
+	{
+		enum Component
+		{
+			CenterX, CenterY, CenterZ,
+			RadiusSquared,
+			ComponentCount
+		};
+
+		static constexpr uint32_t BlockSize{ SimdWidth };
+
+		SharedArray<float> data{};
+		SharedArray<unsigned char> materialIndices{};
+		//Floats per component, padded so full width loads at the last leaf stay inside the array
+		uint32_t stride{};
+
+		const float* Get(Component component) const { return data.data() + component * stride; }
+
+		//Entry k of the SoA holds spheres[order[k]]
+		void Build(const std::vector<Sphere>& spheres, std::span<const uint32_t> order)
+		{
+			const uint32_t sphereAmount{ static_cast<uint32_t>(order.size()) };
+			stride = sphereAmount + BlockSize;
+			std::vector<float> values(size_t{ stride } * ComponentCount, 0.f);
+			std::vector<unsigned char> sphereMaterialIndices(sphereAmount, 0);
+
+			for (uint32_t k{}; k < sphereAmount; ++k)
+			{
+				const Sphere& sphere = spheres[order[k]];
+				values[size_t{ stride } * CenterX + k] = sphere.origin.x;
+				values[size_t{ stride } * CenterY + k] = sphere.origin.y;
+				values[size_t{ stride } * CenterZ + k] = sphere.origin.z;
+				values[size_t{ stride } * RadiusSquared + k] = sphere.radius * sphere.radius;
+				sphereMaterialIndices[k] = sphere.materialIndex;
+			}
+			data = std::move(values);
+			materialIndices = std::move(sphereMaterialIndices);
+		}
+	};
+
+	//Triangles of a mesh in BVH leaf order, one array per component so a SIMD kernel loads a whole leaf at once
+	//BVH leaves are capped at BlockSize triangles, so every leaf [first, first + count) is a single block with precomputed edges
+	struct TriangleSoA
+	{
+		enum Component
+		{
+			V0X, V0Y, V0Z,
+			Edge1X, Edge1Y, Edge1Z,
+			Edge2X, Edge2Y, Edge2Z,
+			NormalX, NormalY, NormalZ,
+			ComponentCount
+		};
+
+		static constexpr uint32_t BlockSize{ SimdWidth };
+
+		SharedArray<float> data{};
+		//Floats per component, padded so full width loads at the last leaf stay inside the array
+		uint32_t stride{};
+
+		const float* Get(Component component) const { return data.data() + component * stride; }
+
+		/**
+		 * \brief Gathers the triangles in the order the BVH leaves reference them
+		 * \param positions vertex positions
+		 * \param normals one normal per triangle, normalized here
+		 * \param indices three vertex indices per triangle
+		 * \param order BVH primitive indices, entry k of the SoA holds triangle order[k]
+		 */
+		void Build(std::span<const Vector3> positions, std::span<const Vector3> normals, std::span<const int> indices,
+			std::span<const uint32_t> order)
+		{
+			const uint32_t triangleAmount{ static_cast<uint32_t>(order.size()) };
+			stride = triangleAmount + BlockSize;
+			std::vector<float> values(size_t{ stride } * ComponentCount, 0.f);
+
+			for (uint32_t k{}; k < triangleAmount; ++k)
+			{
+				const uint32_t triangleIndex{ order[k] };
+				const Vector3& v0{ positions[indices[triangleIndex * 3]] };
+				const Vector3 edge1{ positions[indices[triangleIndex * 3 + 1]] - v0 };
+				const Vector3 edge2{ positions[indices[triangleIndex * 3 + 2]] - v0 };
+				const Vector3 normal{ normals[triangleIndex].Normalized() };
+
+				const Vector3 triangleVectors[]{ v0, edge1, edge2, normal };
+				for (int vector{}; vector < 4; ++vector)
+				{
+					for (int axis{}; axis < 3; ++axis)
+					{
+						values[size_t{ stride } * (vector * 3 + axis) + k] = triangleVectors[vector][axis];
+					}
+				}
+			}
+			data = std::move(values);
+		}
+	};
+
 	struct TriangleMesh
 	{
 		TriangleMesh() = default;
@@ -94,6 +199,13 @@ namespace dae
 		std::vector<Vector3> transformedPositions{};
 		std::vector<Vector3> transformedNormals{};
 
+		//Acceleration structure over the transformed triangles
+		BVH bvh{};
+		//Transformed triangles in the order of the BVH leaves
+		TriangleSoA triangles{};
+		//Incremented on every transform update, so owners can tell the mesh moved
+		uint32_t transformRevision{};
+
 		void Translate(const Vector3& translation)
 		{
 			translationTransform = Matrix::CreateTranslation(translation);
@@ -128,6 +240,15 @@ namespace dae
 				UpdateTransforms();
 		}
 
+		//Welds the duplicate vertices AppendTriangle and OBJ files leave behind and puts the triangles in the leaf order of a BVH
+		//over the untransformed mesh, which the next UpdateTransforms refits. Call it once after importing, before UpdateTransforms
+		void Optimize(float weldDistance = 0.f)
+		{
+			MeshOptimizer::Optimize(positions, normals, indices, weldDistance);
+			bvh.SetMaxLeafSize(TriangleSoA::BlockSize);
+			MeshOptimizer::BuildBVH(positions, normals, indices, bvh);
+		}
+
 		void CalculateNormals()
 		{
 			int triangleAmount{ int(indices.size()) / 3 };
@@ -180,6 +301,38 @@ namespace dae
 
 			//transformedPositions = positions;
 			//transformedNormals = normals;
+
+			UpdateBVH();
+			++transformRevision;
+		}
+
+		AABB GetBounds() const
+		{
+			if (bvh.IsEmpty())
+				return AABB{};
+
+			const BVHNode& root = bvh.GetNodes()[0];
+			return AABB{ root.minAABB, root.maxAABB };
+		}
+
+		void UpdateBVH()
+		{
+			const int triangleAmount{ int(indices.size()) / 3 };
+
+			std::vector<AABB> triangleBounds(triangleAmount);
+			for (int i{}; i < triangleAmount; ++i)
+			{
+				triangleBounds[i].Grow(transformedPositions[indices[i * 3]]);
+				triangleBounds[i].Grow(transformedPositions[indices[i * 3 + 1]]);
+				triangleBounds[i].Grow(transformedPositions[indices[i * 3 + 2]]);
+			}
+
+			//Refits while the mesh animates, the BVH rebuilds itself in the background when the refitted tree gets too slow
+			bvh.SetMaxLeafSize(TriangleSoA::BlockSize);
+			bvh.Update(triangleBounds);
+
+			//The leaf order changes whenever a rebuild is swapped in, so the blocks are gathered again every update
+			triangles.Build(transformedPositions, transformedNormals, indices, bvh.GetPrimitiveIndices());
 		}
 
 		void UpdateAABB()
@@ -235,6 +388,96 @@ namespace dae
 			transformedMaxAABB = tMaxAABB;
 		}
 	};
+
+	//Immutable triangle geometry in object space, shared by any number of TriangleMeshInstances
+	//Geometry loaded from a snapshot borrows its arrays from the mapped file, building it edits owned copies
+	struct MeshGeometry
+	{
+		SharedArray<Vector3> positions{};
+		SharedArray<Vector3> normals{};
+		SharedArray<int> indices{};
+
+		//Built once in object space, instances transform rays instead of vertices
+		BVH bvh{};
+		//Triangles in the order of the BVH leaves
+		TriangleSoA triangles{};
+
+		void CalculateNormals()
+		{
+			const int triangleAmount{ int(indices.size()) / 3 };
+
+			std::vector<Vector3> triangleNormals{};
+			triangleNormals.reserve(triangleAmount);
+			for (int i{}; i < triangleAmount; ++i)
+			{
+				const Vector3 edgeA{ positions[indices[i * 3 + 1]] - positions[indices[i * 3]] };
+				const Vector3 edgeB{ positions[indices[i * 3 + 2]] - positions[indices[i * 3]] };
+				triangleNormals.emplace_back(Vector3::Cross(edgeA, edgeB).Normalized());
+			}
+			normals = std::move(triangleNormals);
+		}
+
+		//Reorders the triangles and vertices into the leaf order of the new BVH
+		void BuildBVH()
+		{
+			bvh.SetMaxLeafSize(TriangleSoA::BlockSize);
+			MeshOptimizer::BuildBVH(positions.Edit(), normals.Edit(), indices.Edit(), bvh);
+			triangles.Build(positions, normals, indices, bvh.GetPrimitiveIndices());
+		}
+
+		AABB GetBounds() const
+		{
+			if (bvh.IsEmpty())
+				return AABB{};
+
+			const BVHNode& root = bvh.GetNodes()[0];
+			return AABB{ root.minAABB, root.maxAABB };
+		}
+	};
+
+	//Places shared MeshGeometry in the world, moving an instance only updates its matrices and bounds
+	struct TriangleMeshInstance
+	{
+		std::shared_ptr<const MeshGeometry> pGeometry{};
+		unsigned char materialIndex{};
+
+		TriangleCullMode cullMode{ TriangleCullMode::BackFaceCulling };
+
+		Matrix rotationTransform{};
+		Matrix translationTransform{};
+		Matrix scaleTransform{};
+
+		Matrix worldTransform{};
+		Matrix inverseWorldTransform{};
+		AABB worldBounds{};
+
+		//Incremented on every transform update, so owners can tell the instance moved
+		uint32_t transformRevision{};
+
+		void Translate(const Vector3& translation)
+		{
+			translationTransform = Matrix::CreateTranslation(translation);
+		}
+
+		void RotateY(float yaw)
+		{
+			rotationTransform = Matrix::CreateRotationY(yaw);
+		}
+
+		void Scale(const Vector3& scale)
+		{
+			scaleTransform = Matrix::CreateScale(scale);
+		}
+
+		void UpdateTransforms()
+		{
+			worldTransform = scaleTransform * rotationTransform * translationTransform;
+			inverseWorldTransform = Matrix::Inverse(worldTransform);
+
+			worldBounds = pGeometry ? pGeometry->GetBounds().Transform(worldTransform) : AABB{};
+			++transformRevision;
+		}
+	};
 #pragma endregion
 #pragma region LIGHT
 	enum class LightType
@@ -272,5 +515,50 @@ namespace dae
 		bool didHit{ false };
 		unsigned char materialIndex{ 0 };
 	};
+
+	//Up to 64 coherent rays traced together, one array per component so SIMD code handles several rays at once
+	//Rays are selected with 64 bit masks, bit i being ray i
+	struct RayPacket
+	{
+		static constexpr uint32_t MaxSize{ 64 };
+
+		uint32_t size{};
+
+		alignas(32) float originX[MaxSize]{};
+		alignas(32) float originY[MaxSize]{};
+		alignas(32) float originZ[MaxSize]{};
+		alignas(32) float directionX[MaxSize]{};
+		alignas(32) float directionY[MaxSize]{};
+		alignas(32) float directionZ[MaxSize]{};
+		alignas(32) float invDirectionX[MaxSize]{};
+		alignas(32) float invDirectionY[MaxSize]{};
+		alignas(32) float invDirectionZ[MaxSize]{};
+		alignas(32) float min[MaxSize]{};
+		alignas(32) float max[MaxSize]{};
+
+		uint64_t GetFullMask() const { return size >= MaxSize ? ~uint64_t{ 0 } : (uint64_t{ 1 } << size) - 1; }
+
+		void SetRay(uint32_t index, const Ray& ray)
+		{
+			originX[index] = ray.origin.x;
+			originY[index] = ray.origin.y;
+			originZ[index] = ray.origin.z;
+			directionX[index] = ray.direction.x;
+			directionY[index] = ray.direction.y;
+			directionZ[index] = ray.direction.z;
+			//Clamped so interval products never multiply an infinity with zero
+			invDirectionX[index] = std::clamp(1.f / ray.direction.x, -1e30f, 1e30f);
+			invDirectionY[index] = std::clamp(1.f / ray.direction.y, -1e30f, 1e30f);
+			invDirectionZ[index] = std::clamp(1.f / ray.direction.z, -1e30f, 1e30f);
+			min[index] = ray.min;
+			max[index] = ray.max;
+		}
+
+		Ray GetRay(uint32_t index) const
+		{
+			return Ray{ { originX[index], originY[index], originZ[index] }, { directionX[index], directionY[index], directionZ[index] },
+				min[index], max[index] };
+		}
+	};
 #pragma endregion
 }
\ No newline at end of file
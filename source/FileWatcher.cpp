@@ -0,0 +1,126 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+namespace
+{
+	std::string Normalize(const std::filesystem::path& path)
+	{
+		std::error_code error{};
+		const std::filesystem::path absolutePath{ std::filesystem::absolute(path, error) };
+		return (error ? path : absolutePath).lexically_normal().string();
+	}
+
+#if !defined(__linux__)
+	std::filesystem::file_time_type GetWriteTime(const std::string& filePath)
+	{
+		std::error_code error{};
+		const std::filesystem::file_time_type writeTime{ std::filesystem::last_write_time(filePath, error) };
+		return error ? std::filesystem::file_time_type{} : writeTime;
+	}
+#endif
+}
+
+FileWatcher::FileWatcher()
+{
+#if defined(__linux__)
+	m_InotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined(__linux__)
+	if (m_InotifyDescriptor >= 0)
+		close(m_InotifyDescriptor);
+#endif
+}
+
+void FileWatcher::Watch(const std::string& filePath)
+{
+	const std::string normalizedPath{ Normalize(filePath) };
+	const bool isWatched{ std::any_of(m_Files.begin(), m_Files.end(),
+		[&normalizedPath](const WatchedFile& file) { return file.normalizedPath == normalizedPath; }) };
+	if (isWatched)
+		return;
+
+	WatchedFile file{ filePath, normalizedPath };
+#if defined(__linux__)
+	//The directory is watched instead of the file, a save that replaces the file would end a watch on the file itself
+	const std::string directory{ std::filesystem::path{ normalizedPath }.parent_path().string() };
+	const bool isDirectoryWatched{ std::any_of(m_Directories.begin(), m_Directories.end(),
+		[&directory](const std::pair<int, std::string>& watchedDirectory) { return watchedDirectory.second == directory; }) };
+	if (m_InotifyDescriptor >= 0 && !isDirectoryWatched)
+	{
+		const int watchDescriptor{ inotify_add_watch(m_InotifyDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) };
+		if (watchDescriptor >= 0)
+			m_Directories.emplace_back(watchDescriptor, directory);
+	}
+#else
+	file.writeTime = GetWriteTime(filePath);
+#endif
+	m_Files.push_back(std::move(file));
+}
+
+std::vector<std::string> FileWatcher::PollChanges()
+{
+	std::vector<std::string> changedFiles{};
+	const auto addChange = [&changedFiles](const std::string& filePath)
+		{
+			if (std::find(changedFiles.begin(), changedFiles.end(), filePath) == changedFiles.end())
+				changedFiles.push_back(filePath);
+		};
+
+#if defined(__linux__)
+	if (m_InotifyDescriptor < 0)
+		return changedFiles;
+
+	alignas(inotify_event) char buffer[4096];
+	while (true)
+	{
+		const ssize_t readSize{ read(m_InotifyDescriptor, buffer, sizeof(buffer)) };
+		if (readSize <= 0)
+			break;
+
+		for (ssize_t offset{ 0 }; offset < readSize;)
+		{
+			const inotify_event* pEvent{ reinterpret_cast<const inotify_event*>(buffer + offset) };
+			offset += sizeof(inotify_event) + pEvent->len;
+			if (pEvent->len == 0)
+				continue;
+
+			const auto directory{ std::find_if(m_Directories.begin(), m_Directories.end(),
+				[pEvent](const std::pair<int, std::string>& watchedDirectory) { return watchedDirectory.first == pEvent->wd; }) };
+			if (directory == m_Directories.end())
+				continue;
+
+			const std::string changedPath{ (std::filesystem::path{ directory->second } / pEvent->name).string() };
+			for (const WatchedFile& file : m_Files)
+			{
+				if (file.normalizedPath == changedPath)
+					addChange(file.path);
+			}
+		}
+	}
+#else
+	for (WatchedFile& file : m_Files)
+	{
+		const std::filesystem::file_time_type writeTime{ GetWriteTime(file.path) };
+		if (writeTime != file.writeTime)
+		{
+			file.writeTime = writeTime;
+			addChange(file.path);
+		}
+	}
+#endif
+
+	return changedFiles;
+}
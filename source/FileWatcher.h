@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#if !defined(__linux__)
+#include <filesystem>
+#endif
+
+namespace dae
+{
+	//Reports files that were written since the last poll, without blocking the caller
+	//Linux watches the directories with inotify, which also catches editors that save by renaming a new file over the old one
+	//Other platforms compare the last write times on every poll
+	class FileWatcher final
+	{
+	public:
+		FileWatcher();
+		~FileWatcher();
+
+		FileWatcher(const FileWatcher&) = delete;
+		FileWatcher(FileWatcher&&) noexcept = delete;
+		FileWatcher& operator=(const FileWatcher&) = delete;
+		FileWatcher& operator=(FileWatcher&&) noexcept = delete;
+
+		//Watching a file twice is fine, a file that does not exist yet is reported once it gets written
+		void Watch(const std::string& filePath);
+		//Files written since the last call as they were passed to Watch, every file at most once
+		std::vector<std::string> PollChanges();
+
+	private:
+		struct WatchedFile
+		{
+			std::string path{};
+			//Absolute and normalized, what changes are matched against
+			std::string normalizedPath{};
+#if !defined(__linux__)
+			std::filesystem::file_time_type writeTime{};
+#endif
+		};
+
+		std::vector<WatchedFile> m_Files{};
+#if defined(__linux__)
+		int m_InotifyDescriptor{ -1 };
+		//Watch descriptor and normalized path of every watched directory
+		std::vector<std::pair<int, std::string>> m_Directories{};
+#endif
+	};
+}
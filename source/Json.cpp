@@ -0,0 +1,40 @@
+#include "Json.h"
+
+#include <cstdio>
+
+using namespace dae;
+
+void Json::WriteEscaped(std::ostream& output, std::string_view text)
+{
+	for (const char character : text)
+	{
+		switch (character)
+		{
+		case '"':
+			output << "\\\"";
+			break;
+		case '\\':
+			output << "\\\\";
+			break;
+		case '\n':
+			output << "\\n";
+			break;
+		case '\r':
+			output << "\\r";
+			break;
+		case '\t':
+			output << "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(character) < 0x20)
+			{
+				char escape[7]{};
+				std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned char>(character));
+				output << escape;
+			}
+			else
+				output << character;
+			break;
+		}
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <ostream>
+#include <string_view>
+
+namespace dae
+{
+	//Helpers for the JSON files the tools write by hand, like traces and benchmark reports
+	namespace Json
+	{
+		//Writes text as the inside of a JSON string, quotes, backslashes and control characters are escaped
+		void WriteEscaped(std::ostream& output, std::string_view text);
+	}
+}
@@ -0,0 +1,557 @@
+//Kernel microbenchmark: feeds pre-generated ray and primitive streams through the intersection kernels and BRDFs in isolation
+//Every kernel is one entry in GetKernels, a SIMD variant of a kernel is added next to its scalar version
+//and runs on the same streams, so both show up side by side in the report
+
+//Standard includes
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "BRDFs.h"
+#include "DataTypes.h"
+#include "Material.h"
+#include "Utils.h"
+
+using namespace dae;
+
+enum class StreamKind
+{
+	HitHeavy, //Rays aimed well inside the primitive
+	MissHeavy, //Rays aimed clearly past the primitive
+	Grazing, //Rays aimed at silhouettes and edges, or nearly parallel to planes
+	Shading //Normal, light and view directions for the BRDFs
+};
+
+//Element i of every primitive array is paired with ray i (or with the shading directions i)
+struct KernelStream
+{
+	StreamKind kind{};
+	std::vector<Ray> rays{};
+
+	std::vector<Sphere> spheres{};
+	SphereSoA sphereBlocks{};
+	std::vector<Plane> planes{};
+	std::vector<Triangle> triangles{};
+	TriangleSoA triangleBlocks{};
+	std::vector<AABB> boxes{};
+	std::vector<TriangleMesh> meshes{};
+
+	std::vector<Vector3> normals{};
+	std::vector<Vector3> lightDirections{};
+	std::vector<Vector3> viewDirections{};
+	std::vector<float> roughness{};
+};
+
+//One pass tests every pair of the stream once and returns how many rays hit (or shaded non-zero)
+struct Kernel
+{
+	std::string name{};
+	bool isShading{};
+	//Tests done by one pass, a SIMD kernel testing a whole block per call counts every lane
+	std::function<uint64_t(const KernelStream&)> getTestCount{};
+	std::function<uint64_t(const KernelStream&)> runPass{};
+	//Rays traced by one pass, the hit rate is per ray, empty when every test traces a ray of its own
+	std::function<uint64_t(const KernelStream&)> getRayCount{};
+};
+
+#pragma region Streams
+class StreamGenerator final
+{
+public:
+	explicit StreamGenerator(uint32_t seed) : m_Random{ seed } {}
+
+	float Uniform(float min, float max) { return std::uniform_real_distribution<float>{ min, max }(m_Random); }
+	Vector3 UniformPoint(float extent) { return { Uniform(-extent, extent), Uniform(-extent, extent), Uniform(-extent, extent) }; }
+
+	Vector3 UnitVector()
+	{
+		while (true)
+		{
+			const Vector3 v{ UniformPoint(1.f) };
+			const float lengthSquared{ v.SqrMagnitude() };
+			if (lengthSquared > 0.0001f && lengthSquared <= 1.f)
+				return v / sqrtf(lengthSquared);
+		}
+	}
+
+	//Random unit vector perpendicular to direction
+	Vector3 Perpendicular(const Vector3& direction)
+	{
+		return Vector3::Cross(direction, UnitVector()).Normalized();
+	}
+
+private:
+	std::mt19937 m_Random;
+};
+
+//How far from the primitive's center a ray aims, relative to its radius
+float GetAimFactor(StreamGenerator& generator, StreamKind kind)
+{
+	switch (kind)
+	{
+	case StreamKind::HitHeavy:
+		return generator.Uniform(0.f, .7f);
+	case StreamKind::Grazing:
+		return generator.Uniform(.97f, 1.f);
+	default:
+		return generator.Uniform(1.3f, 3.f);
+	}
+}
+
+Ray AimRay(StreamGenerator& generator, const Vector3& target, float distance)
+{
+	const Vector3 origin{ target - generator.UnitVector() * distance };
+	return Ray{ origin, (target - origin).Normalized() };
+}
+
+KernelStream CreateStream(StreamKind kind, uint32_t count)
+{
+	StreamGenerator generator{ 1337u + static_cast<uint32_t>(kind) };
+
+	KernelStream stream{};
+	stream.kind = kind;
+
+	if (kind == StreamKind::Shading)
+	{
+		for (uint32_t i{ 0 }; i < count; ++i)
+		{
+			//Light and view in the hemisphere of the normal, like every shaded hit
+			const Vector3 normal{ generator.UnitVector() };
+			Vector3 light{ generator.UnitVector() };
+			Vector3 view{ generator.UnitVector() };
+			if (Vector3::Dot(light, normal) < 0.f)
+				light = -light;
+			if (Vector3::Dot(view, normal) < 0.f)
+				view = -view;
+
+			stream.normals.push_back(normal);
+			stream.lightDirections.push_back(light);
+			stream.viewDirections.push_back(view);
+			stream.roughness.push_back(generator.Uniform(.05f, 1.f));
+		}
+		return stream;
+	}
+
+	//Rays of the sphere stream
+	std::vector<Ray> sphereRays{};
+	for (uint32_t i{ 0 }; i < count; ++i)
+	{
+		Sphere sphere{ generator.UniformPoint(10.f), generator.Uniform(.5f, 2.f) };
+		const Vector3 direction{ generator.UnitVector() };
+		const Vector3 target{ sphere.origin + generator.Perpendicular(direction) * sphere.radius * GetAimFactor(generator, kind) };
+		sphereRays.push_back(Ray{ target - direction * 20.f, direction });
+		stream.spheres.push_back(sphere);
+	}
+
+	//Planes
+	std::vector<Ray> planeRays{};
+	for (uint32_t i{ 0 }; i < count; ++i)
+	{
+		const Plane plane{ generator.UniformPoint(10.f), generator.UnitVector() };
+		const Vector3 tangent{ generator.Perpendicular(plane.normal) };
+		const Vector3 origin{ plane.origin + plane.normal * generator.Uniform(1.f, 10.f) + tangent * generator.Uniform(-5.f, 5.f) };
+
+		Vector3 direction{};
+		switch (kind)
+		{
+		case StreamKind::HitHeavy:
+			direction = -plane.normal + tangent * generator.Uniform(0.f, 1.f);
+			break;
+		case StreamKind::Grazing:
+			direction = tangent - plane.normal * generator.Uniform(.0001f, .01f);
+			break;
+		default:
+			direction = plane.normal + tangent * generator.Uniform(0.f, 1.f);
+			break;
+		}
+		planeRays.push_back(Ray{ origin, direction.Normalized() });
+		stream.planes.push_back(plane);
+	}
+
+	//Triangles, aimed at a barycentric point inside, on an edge or outside the triangle
+	std::vector<Ray> triangleRays{};
+	for (uint32_t i{ 0 }; i < count; ++i)
+	{
+		const Vector3 center{ generator.UniformPoint(10.f) };
+		Triangle triangle{};
+		do
+		{
+			triangle = Triangle{ center + generator.UniformPoint(2.f), center + generator.UniformPoint(2.f), center + generator.UniformPoint(2.f) };
+		} while (Vector3::Cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0).Magnitude() < .5f);
+		triangle.cullMode = TriangleCullMode::NoCulling;
+
+		float u{ generator.Uniform(.05f, .9f) };
+		float v{ generator.Uniform(.05f, .95f - u) };
+		if (kind == StreamKind::Grazing)
+			v = generator.Uniform(-.005f, .005f);
+		else if (kind == StreamKind::MissHeavy)
+			v = generator.Uniform(-1.f, -.2f);
+
+		const Vector3 target{ triangle.v0 + (triangle.v1 - triangle.v0) * u + (triangle.v2 - triangle.v0) * v };
+		const float side{ (i % 2) ? 1.f : -1.f };
+		const Vector3 origin{ target + (triangle.normal * side + generator.UnitVector() * .5f).Normalized() * generator.Uniform(2.f, 10.f) };
+		triangleRays.push_back(Ray{ origin, (target - origin).Normalized() });
+		stream.triangles.push_back(triangle);
+	}
+
+	//Boxes, aimed inside the inscribed sphere, at an edge, or outside the circumscribed sphere
+	std::vector<Ray> boxRays{};
+	for (uint32_t i{ 0 }; i < count; ++i)
+	{
+		const Vector3 center{ generator.UniformPoint(10.f) };
+		const Vector3 halfExtent{ generator.Uniform(.5f, 2.f), generator.Uniform(.5f, 2.f), generator.Uniform(.5f, 2.f) };
+		AABB box{ center - halfExtent, center + halfExtent };
+
+		Vector3 target{};
+		if (kind == StreamKind::Grazing)
+		{
+			const int axis{ static_cast<int>(i % 3) };
+			for (int other{ 0 }; other < 3; ++other)
+			{
+				target[other] = center[other] + halfExtent[other] * (other == axis ? generator.Uniform(-1.f, 1.f) : (generator.Uniform(0.f, 1.f) < .5f ? -1.f : 1.f));
+			}
+			boxRays.push_back(AimRay(generator, target, 20.f));
+		}
+		else
+		{
+			const float radius{ kind == StreamKind::HitHeavy ? std::min({ halfExtent.x, halfExtent.y, halfExtent.z }) : halfExtent.Magnitude() };
+			const Vector3 direction{ generator.UnitVector() };
+			target = center + generator.Perpendicular(direction) * radius * GetAimFactor(generator, kind);
+			boxRays.push_back(Ray{ target - direction * 20.f, direction });
+		}
+
+		TriangleMesh mesh{};
+		mesh.transformedMinAABB = box.min;
+		mesh.transformedMaxAABB = box.max;
+		stream.meshes.push_back(std::move(mesh));
+		stream.boxes.push_back(box);
+	}
+
+	//Ray i is used with every primitive i, so the primitive streams take turns providing the rays
+	//Each kernel picks its own rays through GetRays below
+	stream.rays = std::move(sphereRays);
+	stream.rays.insert(stream.rays.end(), planeRays.begin(), planeRays.end());
+	stream.rays.insert(stream.rays.end(), triangleRays.begin(), triangleRays.end());
+	stream.rays.insert(stream.rays.end(), boxRays.begin(), boxRays.end());
+
+	std::vector<uint32_t> order(count);
+	for (uint32_t i{ 0 }; i < count; ++i)
+	{
+		order[i] = i;
+	}
+	stream.sphereBlocks.Build(stream.spheres, order);
+
+	std::vector<Vector3> positions{};
+	std::vector<Vector3> normals{};
+	std::vector<int> indices{};
+	for (const Triangle& triangle : stream.triangles)
+	{
+		indices.push_back(static_cast<int>(positions.size()));
+		indices.push_back(static_cast<int>(positions.size()) + 1);
+		indices.push_back(static_cast<int>(positions.size()) + 2);
+		positions.insert(positions.end(), { triangle.v0, triangle.v1, triangle.v2 });
+		normals.push_back(triangle.normal);
+	}
+	stream.triangleBlocks.Build(positions, normals, indices, order);
+
+	return stream;
+}
+
+enum class RaySet
+{
+	Spheres,
+	Planes,
+	Triangles,
+	Boxes
+};
+
+const Ray* GetRays(const KernelStream& stream, RaySet raySet)
+{
+	return stream.rays.data() + static_cast<size_t>(raySet) * stream.spheres.size();
+}
+#pragma endregion
+
+#pragma region Kernels
+std::vector<Kernel> GetKernels()
+{
+	const auto pairCount = [](const KernelStream& stream) { return static_cast<uint64_t>(stream.spheres.size()); };
+	const auto shadingCount = [](const KernelStream& stream) { return static_cast<uint64_t>(stream.normals.size()); };
+	//A block kernel tests every ray of a block against all SimdWidth primitives of that block
+	const auto blockCount = [](const KernelStream& stream) { return static_cast<uint64_t>(stream.spheres.size() / SimdWidth * SimdWidth * SimdWidth); };
+	//and reports at most one hit per ray
+	const auto blockRayCount = [](const KernelStream& stream) { return static_cast<uint64_t>(stream.spheres.size() / SimdWidth * SimdWidth); };
+
+	std::vector<Kernel> kernels{};
+
+	//Spheres
+	kernels.push_back({ "HitTest_Sphere (HitRecord)", false, pairCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Spheres) };
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.spheres.size(); ++i)
+			{
+				HitRecord hitRecord{};
+				hits += GeometryUtils::HitTest_Sphere(stream.spheres[i], pRays[i], hitRecord);
+			}
+			return hits;
+		} });
+	kernels.push_back({ "HitTest_Sphere (any hit)", false, pairCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Spheres) };
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.spheres.size(); ++i)
+			{
+				hits += GeometryUtils::HitTest_Sphere(stream.spheres[i], pRays[i]);
+			}
+			return hits;
+		} });
+	kernels.push_back({ "HitTest_SphereBlock (SIMD)", false, blockCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Spheres) };
+			uint64_t hits{ 0 };
+			const uint32_t blockEnd{ static_cast<uint32_t>(stream.spheres.size() / SimdWidth * SimdWidth) };
+			for (uint32_t first{ 0 }; first < blockEnd; first += SimdWidth)
+			{
+				for (uint32_t i{ first }; i < first + SimdWidth; ++i)
+				{
+					float t{ pRays[i].max };
+					hits += GeometryUtils::HitTest_SphereBlock(stream.sphereBlocks, first, SimdWidth, pRays[i], t) >= 0;
+				}
+			}
+			return hits;
+		}, blockRayCount });
+
+	//Planes
+	kernels.push_back({ "HitTest_Plane (HitRecord)", false, pairCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Planes) };
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.planes.size(); ++i)
+			{
+				HitRecord hitRecord{};
+				hits += GeometryUtils::HitTest_Plane(stream.planes[i], pRays[i], hitRecord);
+			}
+			return hits;
+		} });
+	kernels.push_back({ "HitTest_Plane (any hit)", false, pairCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Planes) };
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.planes.size(); ++i)
+			{
+				hits += GeometryUtils::HitTest_Plane(stream.planes[i], pRays[i]);
+			}
+			return hits;
+		} });
+
+	//Triangles
+	kernels.push_back({ "HitTest_Triangle (HitRecord)", false, pairCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Triangles) };
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.triangles.size(); ++i)
+			{
+				HitRecord hitRecord{};
+				hits += GeometryUtils::HitTest_Triangle(stream.triangles[i], pRays[i], hitRecord);
+			}
+			return hits;
+		} });
+	kernels.push_back({ "HitTest_Triangle (any hit)", false, pairCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Triangles) };
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.triangles.size(); ++i)
+			{
+				hits += GeometryUtils::HitTest_Triangle(stream.triangles[i], pRays[i]);
+			}
+			return hits;
+		} });
+	kernels.push_back({ "HitTest_TriangleBlock (SIMD)", false, blockCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Triangles) };
+			uint64_t hits{ 0 };
+			const uint32_t blockEnd{ static_cast<uint32_t>(stream.triangles.size() / SimdWidth * SimdWidth) };
+			for (uint32_t first{ 0 }; first < blockEnd; first += SimdWidth)
+			{
+				for (uint32_t i{ first }; i < first + SimdWidth; ++i)
+				{
+					float t{ pRays[i].max };
+					hits += GeometryUtils::HitTest_TriangleBlock(stream.triangleBlocks, first, SimdWidth, TriangleCullMode::NoCulling, pRays[i], t) >= 0;
+				}
+			}
+			return hits;
+		}, blockRayCount });
+
+	//Bounding boxes
+	kernels.push_back({ "SlabTest_TriangleMesh", false, pairCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Boxes) };
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.meshes.size(); ++i)
+			{
+				hits += GeometryUtils::SlabTest_TriangleMesh(stream.meshes[i], pRays[i]);
+			}
+			return hits;
+		} });
+	kernels.push_back({ "SlabTest_AABB (inverse direction)", false, pairCount, [](const KernelStream& stream)
+		{
+			const Ray* pRays{ GetRays(stream, RaySet::Boxes) };
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.boxes.size(); ++i)
+			{
+				const Ray& ray = pRays[i];
+				const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+				hits += GeometryUtils::SlabTest_AABB(stream.boxes[i].min, stream.boxes[i].max, ray, invDirection) < FLT_MAX;
+			}
+			return hits;
+		} });
+
+	//BRDFs, a result counts as a hit when it is above zero
+	kernels.push_back({ "BRDF::Lambert", true, shadingCount, [](const KernelStream& stream)
+		{
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.normals.size(); ++i)
+			{
+				hits += BRDF::Lambert(stream.roughness[i], colors::White).r > 0.f;
+			}
+			return hits;
+		} });
+	kernels.push_back({ "BRDF::Phong", true, shadingCount, [](const KernelStream& stream)
+		{
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.normals.size(); ++i)
+			{
+				hits += BRDF::Phong(1.f, 60.f, -stream.lightDirections[i], stream.viewDirections[i], stream.normals[i]).r > 0.f;
+			}
+			return hits;
+		} });
+	kernels.push_back({ "BRDF::FresnelFunction_Schlick", true, shadingCount, [](const KernelStream& stream)
+		{
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.normals.size(); ++i)
+			{
+				const Vector3 halfVector{ (stream.viewDirections[i] + stream.lightDirections[i]).Normalized() };
+				hits += BRDF::FresnelFunction_Schlick(halfVector, stream.viewDirections[i], ColorRGB{ .04f, .04f, .04f }).r > 0.f;
+			}
+			return hits;
+		} });
+	kernels.push_back({ "BRDF::NormalDistribution_GGX", true, shadingCount, [](const KernelStream& stream)
+		{
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.normals.size(); ++i)
+			{
+				const Vector3 halfVector{ (stream.viewDirections[i] + stream.lightDirections[i]).Normalized() };
+				hits += BRDF::NormalDistribution_GGX(stream.normals[i], halfVector, stream.roughness[i]) > 0.f;
+			}
+			return hits;
+		} });
+	kernels.push_back({ "BRDF::GeometryFunction_Smith", true, shadingCount, [](const KernelStream& stream)
+		{
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.normals.size(); ++i)
+			{
+				hits += BRDF::GeometryFunction_Smith(stream.normals[i], stream.viewDirections[i], stream.lightDirections[i], stream.roughness[i]) > 0.f;
+			}
+			return hits;
+		} });
+	kernels.push_back({ "Material_CookTorrence::Shade", true, shadingCount, [](const KernelStream& stream)
+		{
+			static Material_CookTorrence material{ { .972f, .960f, .915f }, 1.f, .6f };
+			uint64_t hits{ 0 };
+			for (size_t i{ 0 }; i < stream.normals.size(); ++i)
+			{
+				HitRecord hitRecord{};
+				hitRecord.normal = stream.normals[i];
+				hits += material.Shade(hitRecord, stream.lightDirections[i], stream.viewDirections[i]).r > 0.f;
+			}
+			return hits;
+		} });
+
+	return kernels;
+}
+#pragma endregion
+
+int main(int argc, char* args[])
+{
+	uint32_t pairCount{ 4096 };
+	double minimumTime{ .1 };
+	std::string filter{};
+
+	for (int i{ 1 }; i + 1 < argc; i += 2)
+	{
+		const std::string argument{ args[i] };
+		if (argument == "--count")
+			pairCount = static_cast<uint32_t>(std::strtoul(args[i + 1], nullptr, 10));
+		else if (argument == "--min-time")
+			minimumTime = std::strtod(args[i + 1], nullptr);
+		else if (argument == "--filter")
+			filter = args[i + 1];
+	}
+	if (argc % 2 == 0 || pairCount < static_cast<uint32_t>(SimdWidth) || minimumTime <= 0.0)
+	{
+		std::cerr << "Usage: RayTracerKernelBenchmark [--count <pairs per stream, default 4096>] [--min-time <seconds per measurement, default 0.1>] [--filter <kernel name part>]\n";
+		return 1;
+	}
+
+	const StreamKind intersectionKinds[]{ StreamKind::HitHeavy, StreamKind::MissHeavy, StreamKind::Grazing };
+	const char* streamNames[]{ "hit", "miss", "grazing", "shading" };
+	std::vector<KernelStream> streams{};
+	for (StreamKind kind : intersectionKinds)
+	{
+		streams.push_back(CreateStream(kind, pairCount));
+	}
+	streams.push_back(CreateStream(StreamKind::Shading, pairCount));
+
+	std::cout << "SIMD width " << SimdWidth << ", " << pairCount << " pairs per stream\n";
+	std::cout << std::left << std::setw(36) << "kernel" << std::setw(10) << "stream" << std::right
+		<< std::setw(10) << "ns/test" << std::setw(12) << "Mtests/s" << std::setw(8) << "hit %" << '\n';
+
+	uint64_t checksum{ 0 };
+	for (const Kernel& kernel : GetKernels())
+	{
+		if (!filter.empty() && kernel.name.find(filter) == std::string::npos)
+			continue;
+
+		for (const KernelStream& stream : streams)
+		{
+			if (kernel.isShading != (stream.kind == StreamKind::Shading))
+				continue;
+
+			const uint64_t testsPerPass{ kernel.getTestCount(stream) };
+			const uint64_t raysPerPass{ kernel.getRayCount ? kernel.getRayCount(stream) : testsPerPass };
+			//Warm up caches and branch predictors before measuring
+			const uint64_t hitsPerPass{ kernel.runPass(stream) };
+
+			//Best of three measurements, each running passes until it took at least minimumTime
+			double bestTimePerTest{ DBL_MAX };
+			for (int measurement{ 0 }; measurement < 3; ++measurement)
+			{
+				uint64_t passCount{ 0 };
+				double elapsed{ 0.0 };
+				const auto startTime = std::chrono::steady_clock::now();
+				while (elapsed < minimumTime)
+				{
+					checksum += kernel.runPass(stream);
+					++passCount;
+					elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+				}
+				bestTimePerTest = std::min(bestTimePerTest, elapsed / double(passCount * testsPerPass));
+			}
+
+			std::cout << std::left << std::setw(36) << kernel.name << std::setw(10) << streamNames[static_cast<int>(stream.kind)] << std::right
+				<< std::fixed << std::setprecision(2) << std::setw(10) << bestTimePerTest * 1e9
+				<< std::setw(12) << 1e-6 / bestTimePerTest
+				<< std::setw(8) << std::setprecision(1) << 100.0 * hitsPerPass / raysPerPass << '\n';
+		}
+	}
+
+	//Printed so the compiler has to keep every kernel call
+	std::cout << "checksum " << checksum << '\n';
+	return 0;
+}
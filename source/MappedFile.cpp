@@ -0,0 +1,123 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace dae;
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		std::swap(m_pData, other.m_pData);
+		std::swap(m_Size, other.m_Size);
+		std::swap(m_IsOpen, other.m_IsOpen);
+#if defined(_WIN32)
+		std::swap(m_FileHandle, other.m_FileHandle);
+		std::swap(m_MappingHandle, other.m_MappingHandle);
+#endif
+	}
+	return *this;
+}
+
+bool MappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+#if defined(_WIN32)
+	const HANDLE fileHandle{ CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr) };
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	m_FileHandle = fileHandle;
+	m_Size = static_cast<size_t>(fileSize.QuadPart);
+	m_IsOpen = true;
+	if (m_Size == 0)
+		return true;
+
+	m_MappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_MappingHandle)
+		m_pData = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+	const int fileDescriptor{ open(filePath.c_str(), O_RDONLY) };
+	if (fileDescriptor < 0)
+		return false;
+
+	struct stat fileStatus{};
+	if (fstat(fileDescriptor, &fileStatus) != 0)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	m_Size = static_cast<size_t>(fileStatus.st_size);
+	m_IsOpen = true;
+	if (m_Size == 0)
+	{
+		close(fileDescriptor);
+		return true;
+	}
+
+	//The mapping keeps the file alive, the descriptor is not needed anymore
+	void* pMapping{ mmap(nullptr, m_Size, PROT_READ, MAP_SHARED, fileDescriptor, 0) };
+	close(fileDescriptor);
+	if (pMapping != MAP_FAILED)
+		m_pData = static_cast<const char*>(pMapping);
+#endif
+
+	if (!m_pData)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_MappingHandle)
+		CloseHandle(m_MappingHandle);
+	if (m_FileHandle)
+		CloseHandle(m_FileHandle);
+	m_MappingHandle = nullptr;
+	m_FileHandle = nullptr;
+#else
+	if (m_pData)
+		munmap(const_cast<char*>(m_pData), m_Size);
+#endif
+
+	m_pData = nullptr;
+	m_Size = 0;
+	m_IsOpen = false;
+}
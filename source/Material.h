@@ -6,6 +6,23 @@
 namespace dae
 {
 #pragma region Material BASE
+	enum class MaterialType : unsigned char
+	{
+		SolidColor,
+		Lambert,
+		LambertPhong,
+		CookTorrence
+	};
+
+	//Type and parameters of a material, enough to create it again (scene snapshots store these)
+	struct MaterialDescription
+	{
+		MaterialType type{};
+		ColorRGB color{};
+		//Lambert: kd, LambertPhong: kd, ks, exponent, CookTorrence: metalness, roughness
+		float parameters[3]{};
+	};
+
 	class Material
 	{
 	public:
@@ -25,6 +42,7 @@ namespace dae
 		 * \return color
 		 */
 		virtual ColorRGB Shade(const HitRecord& hitRecord = {}, const Vector3& l = {}, const Vector3& v = {}) = 0;
+		virtual MaterialDescription GetDescription() const = 0;
 	};
 #pragma endregion
 
@@ -43,6 +61,11 @@ namespace dae
 			return m_Color;
 		}
 
+		MaterialDescription GetDescription() const override
+		{
+			return MaterialDescription{ MaterialType::SolidColor, m_Color };
+		}
+
 	private:
 		ColorRGB m_Color{colors::White};
 	};
@@ -62,6 +85,11 @@ namespace dae
 			return BRDF::Lambert(m_DiffuseReflectance, m_DiffuseColor);
 		}
 
+		MaterialDescription GetDescription() const override
+		{
+			return MaterialDescription{ MaterialType::Lambert, m_DiffuseColor, { m_DiffuseReflectance } };
+		}
+
 	private:
 		ColorRGB m_DiffuseColor{colors::White};
 		float m_DiffuseReflectance{1.f}; //kd
@@ -86,6 +114,11 @@ namespace dae
 				+ BRDF::Phong(m_SpecularReflectance, m_PhongExponent, -l, v, hitRecord.normal);
 		}
 
+		MaterialDescription GetDescription() const override
+		{
+			return MaterialDescription{ MaterialType::LambertPhong, m_DiffuseColor, { m_DiffuseReflectance, m_SpecularReflectance, m_PhongExponent } };
+		}
+
 	private:
 		ColorRGB m_DiffuseColor{colors::White};
 		float m_DiffuseReflectance{0.5f}; //kd
@@ -156,10 +189,33 @@ namespace dae
 
 		}
 
+		MaterialDescription GetDescription() const override
+		{
+			return MaterialDescription{ MaterialType::CookTorrence, m_Albedo, { m_Metalness, m_Roughness } };
+		}
+
 	private:
 		ColorRGB m_Albedo{0.955f, 0.637f, 0.538f}; //Copper
 		float m_Metalness{1.0f};
 		float m_Roughness{0.1f}; // [1.0 > 0.0] >> [ROUGH > SMOOTH]
 	};
 #pragma endregion
+
+	//Creates the material a GetDescription call described, nullptr for an unknown type
+	inline Material* CreateMaterial(const MaterialDescription& description)
+	{
+		const float* pParameters{ description.parameters };
+		switch (description.type)
+		{
+		case MaterialType::SolidColor:
+			return new Material_SolidColor{ description.color };
+		case MaterialType::Lambert:
+			return new Material_Lambert{ description.color, pParameters[0] };
+		case MaterialType::LambertPhong:
+			return new Material_LambertPhong{ description.color, pParameters[0], pParameters[1], pParameters[2] };
+		case MaterialType::CookTorrence:
+			return new Material_CookTorrence{ description.color, pParameters[0], pParameters[1] };
+		}
+		return nullptr;
+	}
 }
@@ -1,5 +1,7 @@
 #pragma once
+#include <cfloat>
 #include <cmath>
+#include <cstdint>
 
 namespace dae
 {
@@ -25,6 +27,35 @@ namespace dae
 
 	inline bool AreEqual(float a, float b, float epsilon = FLT_EPSILON)
 	{
-		return abs(a - b) < epsilon;
+		return std::abs(a - b) < epsilon;
+	}
+
+	//Interleaves the bits of x and y (x in the even bits), cells close together in 2D get codes close together
+	inline uint32_t MortonEncode2D(uint16_t x, uint16_t y)
+	{
+		const auto spreadBits = [](uint32_t v)
+			{
+				v = (v | (v << 8)) & 0x00FF00FF;
+				v = (v | (v << 4)) & 0x0F0F0F0F;
+				v = (v | (v << 2)) & 0x33333333;
+				v = (v | (v << 1)) & 0x55555555;
+				return v;
+			};
+		return spreadBits(x) | (spreadBits(y) << 1);
+	}
+
+	//Interleaves the low 10 bits of x, y and z (x in the lowest bit of every triple), the 3D counterpart of MortonEncode2D
+	inline uint32_t MortonEncode3D(uint32_t x, uint32_t y, uint32_t z)
+	{
+		const auto spreadBits = [](uint32_t v)
+			{
+				v &= 0x000003FF;
+				v = (v | (v << 16)) & 0x030000FF;
+				v = (v | (v << 8)) & 0x0300F00F;
+				v = (v | (v << 4)) & 0x030C30C3;
+				v = (v | (v << 2)) & 0x09249249;
+				return v;
+			};
+		return spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2);
 	}
 }
\ No newline at end of file
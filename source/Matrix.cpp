@@ -82,6 +82,40 @@ namespace dae {
 		return out;
 	}
 
+	//Inverse of an affine transform (rotation, scale and translation, last column 0,0,0,1)
+	const Matrix& Matrix::Inverse()
+	{
+		const Vector3 xAxis{ data[0] }, yAxis{ data[1] }, zAxis{ data[2] }, t{ data[3] };
+
+		//Rows of the inverse of the 3x3 part are the cross products of its columns, divided by the determinant
+		const Vector3 c0{ Vector3::Cross(yAxis, zAxis) };
+		const Vector3 c1{ Vector3::Cross(zAxis, xAxis) };
+		const Vector3 c2{ Vector3::Cross(xAxis, yAxis) };
+		const float determinant{ Vector3::Dot(xAxis, c0) };
+		assert(determinant != 0.f);
+		const float invDeterminant{ 1.f / determinant };
+
+		const Vector3 invXAxis{ c0.x * invDeterminant, c1.x * invDeterminant, c2.x * invDeterminant };
+		const Vector3 invYAxis{ c0.y * invDeterminant, c1.y * invDeterminant, c2.y * invDeterminant };
+		const Vector3 invZAxis{ c0.z * invDeterminant, c1.z * invDeterminant, c2.z * invDeterminant };
+		const Vector3 invT{ -(t.x * invXAxis + t.y * invYAxis + t.z * invZAxis) };
+
+		data[0] = { invXAxis, 0 };
+		data[1] = { invYAxis, 0 };
+		data[2] = { invZAxis, 0 };
+		data[3] = { invT, 1 };
+
+		return *this;
+	}
+
+	Matrix Matrix::Inverse(const Matrix& m)
+	{
+		Matrix out{ m };
+		out.Inverse();
+
+		return out;
+	}
+
 	Vector3 Matrix::GetAxisX() const
 	{
 		return data[0];
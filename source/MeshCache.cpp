@@ -0,0 +1,233 @@
+#include "MeshCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <type_traits>
+
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "OBJParser.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr char g_Magic[8]{ 'R', 'T', 'M', 'E', 'S', 'H', '\0', '\0' };
+	//Sections start on a cache line, the alignment BVH4Node has in memory
+	constexpr uint64_t g_SectionAlignment{ 64 };
+
+	enum Section
+	{
+		Positions,
+		TriangleNormals,
+		Indices,
+		Nodes,
+		WideNodes,
+		PrimitiveIndices,
+		TriangleBlocks,
+		SectionCount
+	};
+
+	struct CacheHeader
+	{
+		char magic[8];
+		uint32_t version;
+		//Layout of the stored structs, a build with other struct sizes or another SIMD width rebuilds the cache
+		uint32_t nodeSize;
+		uint32_t wideNodeSize;
+		uint32_t triangleBlockSize;
+		uint32_t triangleStride;
+		uint32_t padding;
+		uint64_t sourceHash;
+		uint64_t sectionOffsets[SectionCount];
+		//In bytes
+		uint64_t sectionSizes[SectionCount];
+	};
+
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + g_SectionAlignment - 1) & ~(g_SectionAlignment - 1);
+	}
+
+	//Sections start on g_SectionAlignment in a page aligned mapping, so the elements are read in place
+	template<typename T>
+	bool ReadSection(const std::shared_ptr<const MappedFile>& pFile, const CacheHeader& header, Section section, SharedArray<T>& elements)
+	{
+		static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= g_SectionAlignment);
+		const uint64_t offset{ header.sectionOffsets[section] };
+		const uint64_t size{ header.sectionSizes[section] };
+		if (offset > pFile->GetSize() || size > pFile->GetSize() - offset || size % sizeof(T) != 0 || offset % g_SectionAlignment != 0)
+			return false;
+
+		elements = SharedArray<T>{ std::span<const T>{ reinterpret_cast<const T*>(pFile->GetData() + offset), size / sizeof(T) }, pFile };
+		return true;
+	}
+
+	void ClearGeometry(MeshGeometry& geometry)
+	{
+		geometry.positions = std::vector<Vector3>{};
+		geometry.normals = std::vector<Vector3>{};
+		geometry.indices = std::vector<int>{};
+		geometry.bvh.Clear();
+		geometry.triangles = TriangleSoA{};
+	}
+}
+
+bool MeshCache::LoadOBJ(const std::string& filename, MeshGeometry& geometry)
+{
+	uint64_t sourceHash{};
+	{
+		MappedFile source{};
+		if (!source.Open(filename))
+			return false;
+		sourceHash = HashContent(source.GetData(), source.GetSize());
+	}
+
+	const std::string cachePath{ filename + ".rtmesh" };
+	if (Load(cachePath, sourceHash, geometry))
+		return true;
+
+	if (!Utils::ParseOBJ(filename, geometry.positions.Edit(), geometry.normals.Edit(), geometry.indices.Edit()))
+		return false;
+	MeshOptimizer::Optimize(geometry.positions.Edit(), geometry.normals.Edit(), geometry.indices.Edit());
+	geometry.BuildBVH();
+
+	//A cache that could not be written only makes the next load slower
+	Save(cachePath, sourceHash, geometry);
+	return true;
+}
+
+bool MeshCache::Save(const std::string& cachePath, uint64_t sourceHash, const MeshGeometry& geometry)
+{
+	const BVH& bvh = geometry.bvh;
+	const std::pair<const void*, uint64_t> sections[SectionCount]
+	{
+		{ geometry.positions.data(), geometry.positions.size() * sizeof(Vector3) },
+		{ geometry.normals.data(), geometry.normals.size() * sizeof(Vector3) },
+		{ geometry.indices.data(), geometry.indices.size() * sizeof(int) },
+		{ bvh.GetNodes().data(), bvh.GetNodes().size() * sizeof(BVHNode) },
+		{ bvh.GetWideNodes().data(), bvh.GetWideNodes().size() * sizeof(BVH4Node) },
+		{ bvh.GetPrimitiveIndices().data(), bvh.GetPrimitiveIndices().size() * sizeof(uint32_t) },
+		{ geometry.triangles.data.data(), geometry.triangles.data.size() * sizeof(float) }
+	};
+
+	CacheHeader header{};
+	std::memcpy(header.magic, g_Magic, sizeof(g_Magic));
+	header.version = Version;
+	header.nodeSize = sizeof(BVHNode);
+	header.wideNodeSize = sizeof(BVH4Node);
+	header.triangleBlockSize = TriangleSoA::BlockSize;
+	header.triangleStride = geometry.triangles.stride;
+	header.sourceHash = sourceHash;
+
+	uint64_t offset{ AlignUp(sizeof(CacheHeader)) };
+	for (int section{ 0 }; section < SectionCount; ++section)
+	{
+		header.sectionOffsets[section] = offset;
+		header.sectionSizes[section] = sections[section].second;
+		offset = AlignUp(offset + sections[section].second);
+	}
+
+	const std::string tempPath{ cachePath + ".tmp" };
+	std::error_code error{};
+	{
+		std::ofstream file{ tempPath, std::ios::binary };
+		if (!file)
+			return false;
+
+		constexpr char padding[g_SectionAlignment]{};
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		uint64_t written{ sizeof(header) };
+		for (int section{ 0 }; section < SectionCount; ++section)
+		{
+			file.write(padding, header.sectionOffsets[section] - written);
+			file.write(static_cast<const char*>(sections[section].first), sections[section].second);
+			written = header.sectionOffsets[section] + sections[section].second;
+		}
+
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::Load(const std::string& cachePath, uint64_t sourceHash, MeshGeometry& geometry)
+{
+	ClearGeometry(geometry);
+
+	const std::shared_ptr<MappedFile> pFile{ std::make_shared<MappedFile>() };
+	if (!pFile->Open(cachePath) || pFile->GetSize() < sizeof(CacheHeader))
+		return false;
+
+	CacheHeader header{};
+	std::memcpy(&header, pFile->GetData(), sizeof(header));
+	if (std::memcmp(header.magic, g_Magic, sizeof(g_Magic)) != 0 || header.version != Version || header.sourceHash != sourceHash
+		|| header.nodeSize != sizeof(BVHNode) || header.wideNodeSize != sizeof(BVH4Node) || header.triangleBlockSize != TriangleSoA::BlockSize)
+		return false;
+
+	SharedArray<BVHNode> nodes{};
+	SharedArray<BVH4Node> wideNodes{};
+	SharedArray<uint32_t> primitiveIndices{};
+	bool isValid{ ReadSection(pFile, header, Positions, geometry.positions)
+		&& ReadSection(pFile, header, TriangleNormals, geometry.normals)
+		&& ReadSection(pFile, header, Indices, geometry.indices)
+		&& ReadSection(pFile, header, Nodes, nodes)
+		&& ReadSection(pFile, header, WideNodes, wideNodes)
+		&& ReadSection(pFile, header, PrimitiveIndices, primitiveIndices)
+		&& ReadSection(pFile, header, TriangleBlocks, geometry.triangles.data) };
+
+	//A damaged cache must not send traversal or shading outside the arrays
+	const size_t triangleCount{ geometry.normals.size() };
+	isValid = isValid && geometry.indices.size() == triangleCount * 3 && primitiveIndices.size() == triangleCount
+		&& header.triangleStride == triangleCount + TriangleSoA::BlockSize
+		&& geometry.triangles.data.size() == size_t{ header.triangleStride } * TriangleSoA::ComponentCount;
+	for (size_t index{ 0 }; isValid && index < geometry.indices.size(); ++index)
+	{
+		isValid = geometry.indices[index] >= 0 && static_cast<size_t>(geometry.indices[index]) < geometry.positions.size();
+	}
+	isValid = isValid && geometry.bvh.Load(std::move(nodes), std::move(wideNodes), std::move(primitiveIndices));
+
+	if (!isValid)
+	{
+		ClearGeometry(geometry);
+		return false;
+	}
+
+	geometry.triangles.stride = header.triangleStride;
+	return true;
+}
+
+uint64_t MeshCache::HashContent(const char* pData, size_t size)
+{
+	constexpr uint64_t prime{ 0x100000001b3 };
+	uint64_t hash{ 0xcbf29ce484222325 };
+
+	size_t position{ 0 };
+	for (; position + sizeof(uint64_t) <= size; position += sizeof(uint64_t))
+	{
+		uint64_t word{};
+		std::memcpy(&word, pData + position, sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+	for (; position < size; ++position)
+	{
+		hash = (hash ^ static_cast<unsigned char>(pData[position])) * prime;
+	}
+
+	//The length keeps files that only differ in trailing zero bytes apart
+	return (hash ^ size) * prime;
+}
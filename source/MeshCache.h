@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Binary copy of a MeshGeometry including its BVH and triangle blocks, so a mesh only gets parsed and built once
+	//The file stores the content hash of the source it came from and is rebuilt as soon as that source changes
+	namespace MeshCache
+	{
+		//Bumped whenever the stored data changes meaning, older caches are rebuilt
+		constexpr uint32_t Version{ 2 };
+
+		/**
+		 * \brief Fills the geometry from an OBJ file, optimized by MeshOptimizer and with its BVH built
+		 * The first load parses and optimizes the OBJ, builds the BVH and writes the cache to filename + ".rtmesh",
+		 * later loads map that cache and read its arrays in place without parsing, building or copying anything
+		 * The mapping stays open for as long as the geometry borrows from it, a refit or rebuild copies only the arrays it writes
+		 * \return false when neither the cache nor the OBJ could be loaded
+		 */
+		bool LoadOBJ(const std::string& filename, MeshGeometry& geometry);
+
+		//Writes through a temporary file, a crash while writing never leaves a half written cache behind
+		bool Save(const std::string& cachePath, uint64_t sourceHash, const MeshGeometry& geometry);
+		//Returns false for a missing, damaged or outdated cache, the geometry is left empty then
+		bool Load(const std::string& cachePath, uint64_t sourceHash, MeshGeometry& geometry);
+
+		//64-bit FNV-1a over 8 byte words
+		uint64_t HashContent(const char* pData, size_t size);
+	}
+}
@@ -0,0 +1,272 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+#include "MathHelpers.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr uint32_t g_InvalidIndex{ std::numeric_limits<uint32_t>::max() };
+
+	uint32_t HashCell(int32_t x, int32_t y, int32_t z)
+	{
+		return (static_cast<uint32_t>(x) * 73856093u) ^ (static_cast<uint32_t>(y) * 19349663u) ^ (static_cast<uint32_t>(z) * 83492791u);
+	}
+
+	//Cells are weldDistance wide, without a distance every distinct position is a cell of its own
+	int32_t GetCell(float coordinate, float weldDistance)
+	{
+		if (weldDistance <= 0.f)
+			return std::bit_cast<int32_t>(coordinate + 0.f); //-0 and 0 share a cell
+
+		const float cell{ std::floor(coordinate / weldDistance) };
+		return static_cast<int32_t>(std::clamp(cell, -2147483520.f, 2147483520.f));
+	}
+
+	class SimulatedCache final
+	{
+	public:
+		void Access(const void* pData, size_t size)
+		{
+			const uintptr_t address{ reinterpret_cast<uintptr_t>(pData) };
+			for (uintptr_t line{ address / LineSize }; line <= (address + size - 1) / LineSize; ++line)
+			{
+				Touch(line);
+			}
+		}
+
+		uint64_t GetMissCount() const { return m_MissCount; }
+
+	private:
+		static constexpr uint32_t LineSize{ 64 };
+		static constexpr uint32_t SetCount{ 64 };
+		static constexpr uint32_t WayCount{ 8 };
+
+		//Line + 1 per way, 0 marks an empty way
+		uint64_t m_Tags[SetCount][WayCount]{};
+		uint64_t m_LastUses[SetCount][WayCount]{};
+		uint64_t m_Time{};
+		uint64_t m_MissCount{};
+
+		void Touch(uint64_t line)
+		{
+			const uint32_t set{ static_cast<uint32_t>(line % SetCount) };
+			++m_Time;
+
+			uint32_t leastRecentWay{ 0 };
+			for (uint32_t way{ 0 }; way < WayCount; ++way)
+			{
+				if (m_Tags[set][way] == line + 1)
+				{
+					m_LastUses[set][way] = m_Time;
+					return;
+				}
+				if (m_LastUses[set][way] < m_LastUses[set][leastRecentWay])
+					leastRecentWay = way;
+			}
+
+			++m_MissCount;
+			m_Tags[set][leastRecentWay] = line + 1;
+			m_LastUses[set][leastRecentWay] = m_Time;
+		}
+	};
+}
+
+uint32_t MeshOptimizer::WeldVertices(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, float weldDistance)
+{
+	const uint32_t vertexCount{ static_cast<uint32_t>(positions.size()) };
+	if (vertexCount == 0)
+		return 0;
+
+	//Buckets hold chains of welded vertices, cells that collide share a chain and are told apart by the distance test
+	const uint32_t bucketCount{ std::bit_ceil(vertexCount * 2) };
+	std::vector<uint32_t> bucketHeads(bucketCount, g_InvalidIndex);
+	std::vector<uint32_t> nextInBucket{};
+	std::vector<Vector3> weldedPositions{};
+	std::vector<uint32_t> remap(vertexCount);
+	nextInBucket.reserve(vertexCount);
+	weldedPositions.reserve(vertexCount);
+
+	const int32_t neighbourRange{ weldDistance > 0.f ? 1 : 0 };
+	const float weldDistanceSquared{ weldDistance * weldDistance };
+	for (uint32_t i{ 0 }; i < vertexCount; ++i)
+	{
+		const Vector3& position{ positions[i] };
+		const int32_t cellX{ GetCell(position.x, weldDistance) };
+		const int32_t cellY{ GetCell(position.y, weldDistance) };
+		const int32_t cellZ{ GetCell(position.z, weldDistance) };
+
+		uint32_t weldedIndex{ g_InvalidIndex };
+		for (int32_t z{ -neighbourRange }; z <= neighbourRange && weldedIndex == g_InvalidIndex; ++z)
+		{
+			for (int32_t y{ -neighbourRange }; y <= neighbourRange && weldedIndex == g_InvalidIndex; ++y)
+			{
+				for (int32_t x{ -neighbourRange }; x <= neighbourRange && weldedIndex == g_InvalidIndex; ++x)
+				{
+					const uint32_t bucket{ HashCell(cellX + x, cellY + y, cellZ + z) & (bucketCount - 1) };
+					for (uint32_t candidate{ bucketHeads[bucket] }; candidate != g_InvalidIndex; candidate = nextInBucket[candidate])
+					{
+						if ((weldedPositions[candidate] - position).SqrMagnitude() <= weldDistanceSquared)
+						{
+							weldedIndex = candidate;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if (weldedIndex == g_InvalidIndex)
+		{
+			weldedIndex = static_cast<uint32_t>(weldedPositions.size());
+			const uint32_t bucket{ HashCell(cellX, cellY, cellZ) & (bucketCount - 1) };
+			weldedPositions.push_back(position);
+			nextInBucket.push_back(bucketHeads[bucket]);
+			bucketHeads[bucket] = weldedIndex;
+		}
+		remap[i] = weldedIndex;
+	}
+
+	//Triangles whose corners merged have no area left
+	const size_t triangleCount{ indices.size() / 3 };
+	const bool hasTriangleNormals{ normals.size() == triangleCount };
+	size_t keptCount{ 0 };
+	for (size_t triangle{ 0 }; triangle < triangleCount; ++triangle)
+	{
+		const int v0{ static_cast<int>(remap[indices[triangle * 3]]) };
+		const int v1{ static_cast<int>(remap[indices[triangle * 3 + 1]]) };
+		const int v2{ static_cast<int>(remap[indices[triangle * 3 + 2]]) };
+		if (v0 == v1 || v1 == v2 || v2 == v0)
+			continue;
+
+		indices[keptCount * 3] = v0;
+		indices[keptCount * 3 + 1] = v1;
+		indices[keptCount * 3 + 2] = v2;
+		if (hasTriangleNormals)
+			normals[keptCount] = normals[triangle];
+		++keptCount;
+	}
+	indices.resize(keptCount * 3);
+	if (hasTriangleNormals)
+		normals.resize(keptCount);
+
+	const uint32_t removedCount{ vertexCount - static_cast<uint32_t>(weldedPositions.size()) };
+	positions = std::move(weldedPositions);
+	return removedCount;
+}
+
+void MeshOptimizer::ReorderTriangles(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, std::span<const uint32_t> order)
+{
+	const uint32_t triangleCount{ static_cast<uint32_t>(order.size()) };
+	const bool hasTriangleNormals{ normals.size() == indices.size() / 3 };
+
+	std::vector<int> orderedIndices(size_t{ triangleCount } * 3);
+	std::vector<Vector3> orderedNormals(hasTriangleNormals ? triangleCount : 0);
+	std::vector<uint32_t> remap(positions.size(), g_InvalidIndex);
+	std::vector<Vector3> orderedPositions{};
+	orderedPositions.reserve(positions.size());
+	for (uint32_t k{ 0 }; k < triangleCount; ++k)
+	{
+		const uint32_t triangle{ order[k] };
+		for (uint32_t corner{ 0 }; corner < 3; ++corner)
+		{
+			const int vertex{ indices[triangle * 3 + corner] };
+			if (remap[vertex] == g_InvalidIndex)
+			{
+				remap[vertex] = static_cast<uint32_t>(orderedPositions.size());
+				orderedPositions.push_back(positions[vertex]);
+			}
+			orderedIndices[k * 3 + corner] = static_cast<int>(remap[vertex]);
+		}
+		if (hasTriangleNormals)
+			orderedNormals[k] = normals[triangle];
+	}
+
+	positions = std::move(orderedPositions);
+	indices = std::move(orderedIndices);
+	if (hasTriangleNormals)
+		normals = std::move(orderedNormals);
+}
+
+void MeshOptimizer::SortTriangles(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+{
+	const uint32_t triangleCount{ static_cast<uint32_t>(indices.size() / 3) };
+	if (triangleCount == 0)
+		return;
+
+	std::vector<Vector3> centroids(triangleCount);
+	Vector3 minCentroid{ FLT_MAX, FLT_MAX, FLT_MAX }, maxCentroid{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t triangle{ 0 }; triangle < triangleCount; ++triangle)
+	{
+		centroids[triangle] = (positions[indices[triangle * 3]] + positions[indices[triangle * 3 + 1]] + positions[indices[triangle * 3 + 2]]) / 3.f;
+		minCentroid = Vector3::Min(minCentroid, centroids[triangle]);
+		maxCentroid = Vector3::Max(maxCentroid, centroids[triangle]);
+	}
+
+	//10 bits per axis over the centroid bounds
+	const Vector3 extent{ maxCentroid - minCentroid };
+	const auto quantize = [](float value, float minValue, float extentValue)
+		{
+			return extentValue > 0.f ? static_cast<uint32_t>(std::clamp((value - minValue) / extentValue, 0.f, 1.f) * 1023.f) : 0u;
+		};
+
+	std::vector<uint64_t> keys(triangleCount);
+	for (uint32_t triangle{ 0 }; triangle < triangleCount; ++triangle)
+	{
+		const Vector3& centroid{ centroids[triangle] };
+		const uint32_t code{ MortonEncode3D(quantize(centroid.x, minCentroid.x, extent.x), quantize(centroid.y, minCentroid.y, extent.y),
+			quantize(centroid.z, minCentroid.z, extent.z)) };
+		//The triangle index breaks ties, so the order does not depend on the sort implementation
+		keys[triangle] = (static_cast<uint64_t>(code) << 32) | triangle;
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<uint32_t> order(triangleCount);
+	for (uint32_t k{ 0 }; k < triangleCount; ++k)
+	{
+		order[k] = static_cast<uint32_t>(keys[k]);
+	}
+	ReorderTriangles(positions, normals, indices, order);
+}
+
+void MeshOptimizer::Optimize(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, float weldDistance)
+{
+	WeldVertices(positions, normals, indices, weldDistance);
+	SortTriangles(positions, normals, indices);
+}
+
+void MeshOptimizer::BuildBVH(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, BVH& bvh)
+{
+	const size_t triangleCount{ indices.size() / 3 };
+	std::vector<AABB> triangleBounds(triangleCount);
+	for (size_t i{ 0 }; i < triangleCount; ++i)
+	{
+		triangleBounds[i].Grow(positions[indices[i * 3]]);
+		triangleBounds[i].Grow(positions[indices[i * 3 + 1]]);
+		triangleBounds[i].Grow(positions[indices[i * 3 + 2]]);
+	}
+
+	bvh.Build(triangleBounds);
+	ReorderTriangles(positions, normals, indices, bvh.GetPrimitiveIndices());
+	bvh.AdoptLeafOrder();
+}
+
+uint64_t MeshOptimizer::CountCacheMisses(std::span<const Vector3> positions, std::span<const Vector3> normals, std::span<const int> indices,
+	std::span<const uint32_t> order)
+{
+	SimulatedCache cache{};
+	for (const uint32_t triangle : order)
+	{
+		cache.Access(&positions[indices[triangle * 3]], sizeof(Vector3));
+		cache.Access(&positions[indices[triangle * 3 + 1]], sizeof(Vector3));
+		cache.Access(&positions[indices[triangle * 3 + 2]], sizeof(Vector3));
+		if (triangle < normals.size())
+			cache.Access(&normals[triangle], sizeof(Vector3));
+	}
+	return cache.GetMissCount();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "BVH.h"
+#include "Vector3.h"
+
+namespace dae
+{
+	//Import time passes over indexed triangle meshes with one normal per triangle
+	//Fewer vertices shrink every array a transform update walks, and triangles that lie close together also lie close together
+	//in memory, so the triangles of a BVH leaf fetch their vertices from a few cache lines instead of all over the mesh
+	namespace MeshOptimizer
+	{
+		/**
+		 * \brief Merges vertices that lie within weldDistance of each other, found through a spatial hash
+		 * Triangles that lose a corner to the merge are removed together with their normal
+		 * \param weldDistance 0 only merges vertices with exactly the same position
+		 * \return the number of vertices removed
+		 */
+		uint32_t WeldVertices(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, float weldDistance = 0.f);
+
+		/**
+		 * \brief Puts the triangles in the given order and renumbers the vertices in the order the triangles first use them
+		 * Vertices no triangle uses are removed
+		 * \param order triangle indices, entry k names the triangle that becomes triangle k
+		 */
+		void ReorderTriangles(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, std::span<const uint32_t> order);
+		//Reorders the triangles along a Morton curve through their centroids
+		void SortTriangles(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices);
+
+		//Welds, then sorts
+		void Optimize(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, float weldDistance = 0.f);
+
+		/**
+		 * \brief Builds the BVH over the triangles and reorders them into its leaf order, so every leaf references one contiguous
+		 * range of triangles and, through the vertex renumbering, a mostly contiguous range of vertices
+		 * Set the maximum leaf size on the BVH before
+		 */
+		void BuildBVH(std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices, BVH& bvh);
+
+		/**
+		 * \brief Counts the cache lines a walk over the triangles misses while fetching their vertices and normal
+		 * The walk goes through a simulated 32KB, 8-way set associative cache with 64 byte lines and LRU replacement, like an L1 data cache
+		 * \param order triangle indices in the order they are visited, usually the BVH primitive indices
+		 */
+		uint64_t CountCacheMisses(std::span<const Vector3> positions, std::span<const Vector3> normals, std::span<const int> indices,
+			std::span<const uint32_t> order);
+	}
+}
@@ -0,0 +1,309 @@
+#include "OBJParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+using namespace dae;
+
+namespace
+{
+	//Files below this size are parsed on the calling thread
+	constexpr size_t g_MinParallelFileSize{ 1 << 18 };
+	constexpr uint32_t g_ChunksPerThread{ 4 };
+
+	struct Corner
+	{
+		int position;
+		//Only set when hasNormal, a resolved relative index can be any value, so no index can mark a missing vn
+		int normal;
+		bool hasNormal;
+	};
+
+	//Everything one chunk of lines declares, indices are resolved once every chunk's vertex count is known
+	struct OBJChunk
+	{
+		std::vector<Vector3> positions{};
+		std::vector<Vector3> vertexNormals{};
+		//Three corners per triangle, absolute indices are 0 based, relative ones count from this chunk's first vertex
+		std::vector<Corner> corners{};
+		std::vector<uint32_t> relativePositionCorners{};
+		std::vector<uint32_t> relativeNormalCorners{};
+		bool isValid{ true };
+	};
+
+	const char* SkipSpaces(const char* pCurrent, const char* pEnd)
+	{
+		while (pCurrent < pEnd && (*pCurrent == ' ' || *pCurrent == '\t' || *pCurrent == '\r'))
+			++pCurrent;
+		return pCurrent;
+	}
+
+	template<typename T>
+	bool ParseNumber(const char*& pCurrent, const char* pEnd, T& value)
+	{
+		pCurrent = SkipSpaces(pCurrent, pEnd);
+		//from_chars does not accept a leading plus sign
+		if (pCurrent < pEnd && *pCurrent == '+')
+			++pCurrent;
+
+		const auto [pNext, error] = std::from_chars(pCurrent, pEnd, value);
+		if (error != std::errc{})
+			return false;
+
+		pCurrent = pNext;
+		return true;
+	}
+
+	bool ParseVector(const char* pCurrent, const char* pEnd, Vector3& vector)
+	{
+		return ParseNumber(pCurrent, pEnd, vector.x) && ParseNumber(pCurrent, pEnd, vector.y) && ParseNumber(pCurrent, pEnd, vector.z);
+	}
+
+	/**
+	 * \brief Turns an OBJ index into an index for the chunk
+	 * \param index 1 based absolute index, or negative to count back from the last element declared so far
+	 * \param localCount elements this chunk declared so far
+	 * \return false for index 0, which OBJ does not allow
+	 */
+	bool ResolveIndex(int index, size_t localCount, int& resolved, bool& isRelative)
+	{
+		isRelative = index < 0;
+		resolved = isRelative ? static_cast<int>(localCount) + index : index - 1;
+		return index != 0;
+	}
+
+	//Parses one "f" line after the keyword, v, v/vt, v//vn or v/vt/vn per corner
+	bool ParseFace(const char* pCurrent, const char* pEnd, OBJChunk& chunk, std::vector<Corner>& faceCorners, std::vector<bool>& relativeFlags)
+	{
+		faceCorners.clear();
+		relativeFlags.clear();
+
+		while (true)
+		{
+			pCurrent = SkipSpaces(pCurrent, pEnd);
+			if (pCurrent >= pEnd)
+				break;
+
+			int positionIndex{}, normalIndex{};
+			Corner corner{ 0, 0, false };
+			bool isPositionRelative{}, isNormalRelative{};
+			if (!ParseNumber(pCurrent, pEnd, positionIndex) || !ResolveIndex(positionIndex, chunk.positions.size(), corner.position, isPositionRelative))
+				return false;
+
+			if (pCurrent < pEnd && *pCurrent == '/')
+			{
+				++pCurrent;
+				//Texture coordinates are not used
+				int textureIndex{};
+				if (pCurrent < pEnd && *pCurrent != '/' && !ParseNumber(pCurrent, pEnd, textureIndex))
+					return false;
+
+				if (pCurrent < pEnd && *pCurrent == '/')
+				{
+					++pCurrent;
+					if (!ParseNumber(pCurrent, pEnd, normalIndex) || !ResolveIndex(normalIndex, chunk.vertexNormals.size(), corner.normal, isNormalRelative))
+						return false;
+					corner.hasNormal = true;
+				}
+			}
+
+			faceCorners.push_back(corner);
+			relativeFlags.push_back(isPositionRelative);
+			relativeFlags.push_back(isNormalRelative);
+		}
+
+		if (faceCorners.size() < 3)
+			return false;
+
+		//Triangle fan around the first corner
+		for (size_t corner{ 1 }; corner + 1 < faceCorners.size(); ++corner)
+		{
+			for (const size_t faceCorner : { size_t{ 0 }, corner, corner + 1 })
+			{
+				const uint32_t cornerIndex{ static_cast<uint32_t>(chunk.corners.size()) };
+				if (relativeFlags[faceCorner * 2])
+					chunk.relativePositionCorners.push_back(cornerIndex);
+				if (relativeFlags[faceCorner * 2 + 1])
+					chunk.relativeNormalCorners.push_back(cornerIndex);
+				chunk.corners.push_back(faceCorners[faceCorner]);
+			}
+		}
+		return true;
+	}
+
+	void ParseChunk(const char* pCurrent, const char* pEnd, OBJChunk& chunk)
+	{
+		std::vector<Corner> faceCorners{};
+		std::vector<bool> relativeFlags{};
+
+		while (pCurrent < pEnd && chunk.isValid)
+		{
+			const char* pLineEnd{ static_cast<const char*>(std::memchr(pCurrent, '\n', pEnd - pCurrent)) };
+			if (!pLineEnd)
+				pLineEnd = pEnd;
+
+			//A comment runs to the end of the line, also behind a statement
+			const char* pCommentStart{ static_cast<const char*>(std::memchr(pCurrent, '#', pLineEnd - pCurrent)) };
+			const char* pContentEnd{ pCommentStart ? pCommentStart : pLineEnd };
+
+			const char* pKeyword{ SkipSpaces(pCurrent, pContentEnd) };
+			const char* pKeywordEnd{ pKeyword };
+			while (pKeywordEnd < pContentEnd && *pKeywordEnd != ' ' && *pKeywordEnd != '\t')
+				++pKeywordEnd;
+
+			const std::string_view keyword(pKeyword, pKeywordEnd - pKeyword);
+			if (keyword == "v")
+			{
+				Vector3 position{};
+				chunk.isValid = ParseVector(pKeywordEnd, pContentEnd, position);
+				chunk.positions.push_back(position);
+			}
+			else if (keyword == "vn")
+			{
+				Vector3 normal{};
+				chunk.isValid = ParseVector(pKeywordEnd, pContentEnd, normal);
+				chunk.vertexNormals.push_back(normal);
+			}
+			else if (keyword == "f")
+			{
+				chunk.isValid = ParseFace(pKeywordEnd, pContentEnd, chunk, faceCorners, relativeFlags);
+			}
+			//Texture coordinates, groups and materials are skipped
+
+			pCurrent = pLineEnd + 1;
+		}
+	}
+}
+
+bool Utils::ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices,
+	uint32_t threadCount)
+{
+	MappedFile file{};
+	if (!file.Open(filename))
+		return false;
+
+	const char* pData{ file.GetData() };
+	const size_t fileSize{ file.GetSize() };
+
+	if (threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	if (fileSize < g_MinParallelFileSize)
+		threadCount = 1;
+
+	//Chunks start at the beginning of a line, several per thread so uneven chunks even out
+	const uint32_t chunkCount{ threadCount == 1 ? 1 : threadCount * g_ChunksPerThread };
+	std::vector<size_t> chunkStarts(chunkCount + 1, fileSize);
+	chunkStarts[0] = 0;
+	for (uint32_t chunk{ 1 }; chunk < chunkCount; ++chunk)
+	{
+		size_t start{ std::max(fileSize / chunkCount * chunk, chunkStarts[chunk - 1]) };
+		while (start < fileSize && pData[start - 1] != '\n')
+			++start;
+		chunkStarts[chunk] = start;
+	}
+
+	ThreadPool threadPool{ threadCount };
+	std::vector<OBJChunk> chunks(chunkCount);
+	threadPool.ParallelFor(chunkCount, [&](uint32_t chunk)
+		{
+			ParseChunk(pData + chunkStarts[chunk], pData + chunkStarts[chunk + 1], chunks[chunk]);
+		});
+
+	//Where every chunk's vertices, normals and triangles go in the merged arrays
+	const size_t firstPosition{ positions.size() };
+	const size_t firstTriangle{ normals.size() };
+	const size_t firstIndex{ indices.size() };
+	std::vector<size_t> positionOffsets(chunkCount + 1, 0);
+	std::vector<size_t> normalOffsets(chunkCount + 1, 0);
+	std::vector<size_t> cornerOffsets(chunkCount + 1, 0);
+	for (uint32_t chunk{ 0 }; chunk < chunkCount; ++chunk)
+	{
+		if (!chunks[chunk].isValid)
+			return false;
+
+		positionOffsets[chunk + 1] = positionOffsets[chunk] + chunks[chunk].positions.size();
+		normalOffsets[chunk + 1] = normalOffsets[chunk] + chunks[chunk].vertexNormals.size();
+		cornerOffsets[chunk + 1] = cornerOffsets[chunk] + chunks[chunk].corners.size();
+	}
+
+	const int positionCount{ static_cast<int>(positionOffsets[chunkCount]) };
+	const int vertexNormalCount{ static_cast<int>(normalOffsets[chunkCount]) };
+	std::vector<Vector3> vertexNormals(vertexNormalCount);
+	std::vector<int> triangleIndices(cornerOffsets[chunkCount]);
+	std::vector<Vector3> triangleNormals(cornerOffsets[chunkCount] / 3);
+
+	//Indices are checked against the merged counts, a bad index fails the whole load
+	std::atomic<bool> isValid{ true };
+	positions.resize(firstPosition + positionCount);
+	threadPool.ParallelFor(chunkCount, [&](uint32_t chunk)
+		{
+			OBJChunk& objChunk = chunks[chunk];
+			std::copy(objChunk.positions.begin(), objChunk.positions.end(), positions.begin() + firstPosition + positionOffsets[chunk]);
+			std::copy(objChunk.vertexNormals.begin(), objChunk.vertexNormals.end(), vertexNormals.begin() + normalOffsets[chunk]);
+
+			for (uint32_t corner : objChunk.relativePositionCorners)
+			{
+				objChunk.corners[corner].position += static_cast<int>(positionOffsets[chunk]);
+			}
+			for (uint32_t corner : objChunk.relativeNormalCorners)
+			{
+				objChunk.corners[corner].normal += static_cast<int>(normalOffsets[chunk]);
+			}
+
+			for (size_t corner{ 0 }; corner < objChunk.corners.size(); ++corner)
+			{
+				const Corner& objCorner = objChunk.corners[corner];
+				const bool isNormalValid{ !objCorner.hasNormal || (objCorner.normal >= 0 && objCorner.normal < vertexNormalCount) };
+				if (objCorner.position < 0 || objCorner.position >= positionCount || !isNormalValid)
+				{
+					isValid = false;
+					return;
+				}
+				triangleIndices[cornerOffsets[chunk] + corner] = objCorner.position;
+			}
+		});
+	if (!isValid)
+	{
+		positions.resize(firstPosition);
+		return false;
+	}
+
+	//Normals need every position and vn in place
+	threadPool.ParallelFor(chunkCount, [&](uint32_t chunk)
+		{
+			const OBJChunk& objChunk = chunks[chunk];
+			for (size_t corner{ 0 }; corner < objChunk.corners.size(); corner += 3)
+			{
+				const Corner* pCorners{ &objChunk.corners[corner] };
+				Vector3 normal{};
+				if (pCorners[0].hasNormal && pCorners[1].hasNormal && pCorners[2].hasNormal)
+				{
+					normal = vertexNormals[pCorners[0].normal] + vertexNormals[pCorners[1].normal] + vertexNormals[pCorners[2].normal];
+				}
+				if (normal.SqrMagnitude() <= FLT_MIN)
+				{
+					const Vector3& v0 = positions[firstPosition + pCorners[0].position];
+					normal = Vector3::Cross(positions[firstPosition + pCorners[1].position] - v0, positions[firstPosition + pCorners[2].position] - v0);
+				}
+				normal.Normalize();
+
+				triangleNormals[(cornerOffsets[chunk] + corner) / 3] = normal;
+			}
+		});
+
+	indices.resize(firstIndex + triangleIndices.size());
+	for (size_t index{ 0 }; index < triangleIndices.size(); ++index)
+	{
+		indices[firstIndex + index] = static_cast<int>(firstPosition) + triangleIndices[index];
+	}
+	normals.insert(normals.begin() + firstTriangle, triangleNormals.begin(), triangleNormals.end());
+	return true;
+}
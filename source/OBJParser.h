@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Vector3.h"
+
+namespace dae
+{
+	namespace Utils
+	{
+		/**
+		 * \brief Loads the triangles of an OBJ file, memory mapped and parsed in parallel chunks
+		 * Faces can use every f syntax (v, v/vt, v//vn, v/vt/vn) and negative indices, polygons become triangle fans
+		 * \param filename OBJ file to load
+		 * \param positions receives the vertex positions, appended after the ones already in it
+		 * \param normals receives one normal per triangle, the average of its vn normals or the winding normal when it has none
+		 * \param indices receives three indices into positions per triangle
+		 * \param threadCount parsing threads, 0 uses every hardware thread
+		 * \return false when the file could not be read or a face references a vertex that does not exist, the vectors are left unchanged then
+		 */
+		bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices,
+			uint32_t threadCount = 0);
+	}
+}
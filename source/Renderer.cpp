@@ -1,7 +1,3 @@
-//External includes
-#include "SDL.h"
-#include "SDL_surface.h"
-
 //Project includes
 #include "Renderer.h"
 #include "Math.h"
@@ -9,100 +5,238 @@
 #include "Material.h"
 #include "Scene.h"
 #include "Utils.h"
+#include "ThreadPool.h"
+#include "Trace.h"
 #include <iostream>
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <fstream>
 #include <future> //async
-#include <ppl.h> //parallel_for
 
 using namespace dae;
 
-//#define ASYNC
-#define PARALLEL_FOR
-
-Renderer::Renderer(SDL_Window * pWindow) :
-	m_pWindow(pWindow),
-	m_pBuffer(SDL_GetWindowSurface(pWindow))
+Renderer::Renderer(uint32_t* pBufferPixels, int width, int height, uint32_t threadCount) :
+	m_pBufferPixels(pBufferPixels),
+	m_Width(width),
+	m_Height(height),
+	m_pThreadPool(std::make_unique<ThreadPool>(threadCount))
 {
 	//Initialize
-	SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
-	m_pBufferPixels = static_cast<uint32_t*>(m_pBuffer->pixels);
+	UpdateTileOrder();
 }
 
+Renderer::~Renderer() = default;
+
 void Renderer::Render(Scene* pScene) const
 {
+	const TraceScope renderScope{ "Renderer::Render" };
+
+	{
+		const TraceScope traceScope{ "Scene::UpdateAccelerationStructure" };
+		pScene->UpdateAccelerationStructure();
+	}
+
 	Camera& camera = pScene->GetCamera();
-	camera.CalculateCameraToWorld();
+	{
+		const TraceScope traceScope{ "Camera::CalculateCameraToWorld" };
+		camera.CalculateCameraToWorld();
+	}
 
 	const float fov{ tanf((camera.fovAngle * TO_RADIANS) / 2.f) };
 	const float aspectRatio{ float(m_Width) / float(m_Height) };
 
 	auto& materials = pScene->GetMaterials();
-	auto& lights = pScene->GetLights();
 
-	const uint32_t numPixels = m_Width * m_Height;
+	if (IsCollectingCosts())
+		m_PixelCosts.resize(size_t(m_Width) * m_Height);
+	else
+		m_PixelCosts.clear();
 
-#if defined(ASYNC)
-	//Async execution
-	const uint32_t numCores = std::thread::hardware_concurrency();
-	std::vector<std::future<void>> async_futures{};
-	const uint32_t numPixelsPerTask = numPixels / numCores;
-	uint32_t numUnassignedPixels = numPixels % numCores;
-	uint32_t currPixelIndex = 0;
+	//Every task renders one tile, tasks are handed out in Morton order
+	const uint32_t numTasks = static_cast<uint32_t>(m_TileOrder.size());
+	const auto renderTask = [&](uint32_t taskIndex)
+		{
+			const TraceScope traceScope{ "Tile", m_TileOrder[taskIndex] };
+			const auto startTime = std::chrono::steady_clock::now();
+#if RAYTRACER_ENABLE_STATS
+			const StatBlock startStats{ GetThreadStats() };
+#endif
+			m_TileRayCounts[taskIndex] = RenderTile(pScene, m_TileOrder[taskIndex], fov, aspectRatio, camera, materials);
+			m_TileCosts[taskIndex] = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+#if RAYTRACER_ENABLE_STATS
+			m_TileStats[taskIndex] = GetThreadStats() - startStats;
+#endif
+		};
 
-	for (uint32_t coreId{ 0 }; coreId < numCores; ++coreId)
 	{
-		uint32_t taskSize = numPixelsPerTask;
-		if (numUnassignedPixels > 0)
+		const TraceScope traceScope{ "Pixels" };
+		switch (m_ExecutionMode)
 		{
-			++taskSize;
-			--numUnassignedPixels;
-		}
-
-		async_futures.push_back(std::async(std::launch::async, [=, this]
+		case ExecutionMode::Async:
+		{
+			//Async execution
+			const uint32_t numCores = GetThreadCount();
+			std::vector<std::future<void>> async_futures{};
+			const uint32_t numTilesPerTask = numTasks / numCores;
+			uint32_t numUnassignedTiles = numTasks % numCores;
+			uint32_t currTileIndex = 0;
+
+			for (uint32_t coreId{ 0 }; coreId < numCores; ++coreId)
 			{
-				//Render all pixels for this task (currPixelIndex > currPixelIndex + taskSize)
-				const uint32_t pixelIndexEnd = currPixelIndex + taskSize;
-				for (uint32_t pixelIndex{ currPixelIndex }; pixelIndex < pixelIndexEnd; ++pixelIndex)
+				uint32_t taskSize = numTilesPerTask;
+				if (numUnassignedTiles > 0)
 				{
-					RenderPixel(pScene, pixelIndex, fov, aspectRatio, camera, lights, materials);
+					++taskSize;
+					--numUnassignedTiles;
 				}
-			}));
 
-		currPixelIndex += taskSize;
+				async_futures.push_back(std::async(std::launch::async, [=, &renderTask]
+					{
+						//Render all tiles for this task (currTileIndex > currTileIndex + taskSize)
+						const uint32_t tileIndexEnd = currTileIndex + taskSize;
+						for (uint32_t tileIndex{ currTileIndex }; tileIndex < tileIndexEnd; ++tileIndex)
+						{
+							renderTask(tileIndex);
+						}
+					}));
+
+				currTileIndex += taskSize;
+			}
+
+			//Wait for async completion of all tasks
+			for (const std::future<void>& f : async_futures)
+			{
+				f.wait();
+			}
+			break;
+		}
+		case ExecutionMode::ParallelFor:
+			//Parallel-For Execution
+			m_pThreadPool->ParallelFor(numTasks, renderTask);
+			break;
+		case ExecutionMode::WorkStealing:
+			//Work-Stealing Execution
+			m_pThreadPool->ParallelFor(AssignTiles(m_pThreadPool->GetThreadCount()), renderTask);
+			break;
+		case ExecutionMode::Synchronous:
+			//Synchronous Execution (No Threading)
+			for (uint32_t i{ 0 }; i < numTasks; ++i)
+			{
+				renderTask(i);
+			}
+			break;
+		}
 	}
 
-	//Wait for async completion of all tasks
-	for (const std::future<void>& f : async_futures)
+	if (m_CurrentLightingMode == LightingMode::Cost)
 	{
-		f.wait();
+		const TraceScope traceScope{ "Renderer::DrawCostHeatmap" };
+		DrawCostHeatmap();
 	}
+}
 
-#elif defined(PARALLEL_FOR)
-	//Parallel-For Execution
-	concurrency::parallel_for(0u, numPixels, [=, this](int i) {
-		RenderPixel(pScene, i, fov, aspectRatio, camera, lights, materials);
-		});
+uint32_t Renderer::RenderTile(Scene* pScene, uint32_t tileIndex, float fov, float aspectRatio, const Camera& camera,
+	const std::vector<Material*>& materials) const
+{
+	const int tilesPerRow = (m_Width + m_TileSize - 1) / m_TileSize;
+	const int startX = (tileIndex % tilesPerRow) * m_TileSize;
+	const int startY = (tileIndex / tilesPerRow) * m_TileSize;
+	const int endX = std::min(startX + m_TileSize, m_Width);
+	const int endY = std::min(startY + m_TileSize, m_Height);
+
+	uint32_t rayCount{ 0 };
+	if (m_PacketTracingEnabled && m_PixelCosts.empty())
+	{
+		//Packets at the right and bottom edge of the tile hold fewer rays
+		for (int py{ startY }; py < endY; py += m_PacketSize)
+		{
+			for (int px{ startX }; px < endX; px += m_PacketSize)
+			{
+				rayCount += RenderPacket(pScene, px, py, std::min(px + m_PacketSize, endX), std::min(py + m_PacketSize, endY),
+					fov, aspectRatio, camera, materials);
+			}
+		}
+		return rayCount;
+	}
 
-#else
-	//Synchronous Execution (No Threading)
-	for (uint32_t i{ 0 }; i < numPixels; ++i)
+	for (int py{ startY }; py < endY; ++py)
 	{
-		RenderPixel(pScene, i, fov, aspectRatio, camera, lights, materials);
+		for (int px{ startX }; px < endX; ++px)
+		{
+			rayCount += RenderPixel(pScene, px + py * m_Width, fov, aspectRatio, camera, materials);
+		}
 	}
+	return rayCount;
+}
+
+uint32_t Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Camera& camera,
+	const std::vector<Material*>& materials) const
+{
+	const int px = pixelIndex % m_Width;
+	const int py = pixelIndex / m_Width;
 
+	const Vector3 rayDirection{ GetViewRayDirection(px, py, fov, aspectRatio, camera) };
+	const Ray viewRay{ camera.origin, rayDirection };
+	RAYTRACER_STAT_INC(PrimaryRays);
 
-#endif
+	HitRecord closestHit{};
+	if (m_PixelCosts.empty())
+	{
+		pScene->GetClosestHit(viewRay, closestHit);
+		return 1 + ShadePixel(pScene, px, py, rayDirection, closestHit, materials);
+	}
+
+	//The counters are only read while costs are collected
+	const StatBlock startStats{ GetThreadStats() };
+	pScene->GetClosestHit(viewRay, closestHit);
 
-	//@END
-	//Update SDL Surface
-	SDL_UpdateWindowSurface(m_pWindow);
+	const auto shadeStartTime = std::chrono::steady_clock::now();
+	const uint32_t shadowRayCount{ ShadePixel(pScene, px, py, rayDirection, closestHit, materials) };
+
+	PixelCost& pixelCost = m_PixelCosts[pixelIndex];
+	pixelCost.shadingTime = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - shadeStartTime).count();
+	pixelCost.shadowRays = shadowRayCount;
+	const StatBlock pixelStats{ GetThreadStats() - startStats };
+	pixelCost.nodeVisits = static_cast<uint32_t>(pixelStats[StatCounter::NodeVisits]);
+	pixelCost.primitiveTests = static_cast<uint32_t>(pixelStats[StatCounter::PrimitiveTests]);
+
+	return 1 + shadowRayCount;
 }
 
-void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, const Camera& camera,
-	const std::vector<Light>& lights, const std::vector<Material*>& materials) const
+uint32_t Renderer::RenderPacket(Scene* pScene, int startX, int startY, int endX, int endY, float fov, float aspectRatio,
+	const Camera& camera, const std::vector<Material*>& materials) const
 {
-	const int px = pixelIndex % m_Width;
-	const int py = pixelIndex / m_Width;
+	RayPacket packet{};
+	for (int py{ startY }; py < endY; ++py)
+	{
+		for (int px{ startX }; px < endX; ++px)
+		{
+			packet.SetRay(packet.size++, Ray{ camera.origin, GetViewRayDirection(px, py, fov, aspectRatio, camera) });
+		}
+	}
+
+	RAYTRACER_STAT_ADD(PrimaryRays, packet.size);
+
+	HitRecord closestHits[RayPacket::MaxSize]{};
+	pScene->GetClosestHits(packet, closestHits);
+
+	uint32_t rayIndex{ 0 };
+	uint32_t rayCount{ packet.size };
+	for (int py{ startY }; py < endY; ++py)
+	{
+		for (int px{ startX }; px < endX; ++px)
+		{
+			const Vector3 rayDirection{ packet.directionX[rayIndex], packet.directionY[rayIndex], packet.directionZ[rayIndex] };
+			rayCount += ShadePixel(pScene, px, py, rayDirection, closestHits[rayIndex], materials);
+			++rayIndex;
+		}
+	}
+	return rayCount;
+}
 
+Vector3 Renderer::GetViewRayDirection(int px, int py, float fov, float aspectRatio, const Camera& camera) const
+{
 	float rx = px + 0.5f;
 	float ry = py + 0.5f;
 
@@ -112,13 +246,14 @@ void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float
 	Vector3 rayDirection{ cx * camera.right + cy * camera.up + camera.forward };
 	rayDirection.Normalize();
 	camera.cameraToWorld.TransformVector(rayDirection);
-	const Ray viewRay{ camera.origin, rayDirection };
-
+	return rayDirection;
+}
 
+uint32_t Renderer::ShadePixel(Scene* pScene, int px, int py, const Vector3& rayDirection, const HitRecord& closestHit,
+	const std::vector<Material*>& materials) const
+{
 	ColorRGB finalColor{};
-	HitRecord closestHit{};
-
-	pScene->GetClosestHit(viewRay, closestHit);
+	uint32_t shadowRayCount{ 0 };
 
 	//if a pixel is hit by viewRay
 	if (closestHit.didHit)
@@ -134,7 +269,9 @@ void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float
 				const float invtLightRayOffset{ 0.0001f };
 				Vector3 closestHitOriginOffset{ closestHit.origin + closestHit.normal * invtLightRayOffset };
 				Ray invtLightRay{ closestHitOriginOffset, directionToLight.Normalized(), 0.0001f, directionToLight.Magnitude() };
-				if (pScene->DoesHit(invtLightRay))
+				++shadowRayCount;
+				RAYTRACER_STAT_INC(ShadowRays);
+				if (pScene->IsOccluded(invtLightRay))
 				{
 					continue;
 				}
@@ -147,6 +284,7 @@ void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float
 			ColorRGB radiance{ LightUtils::GetRadiance(light, closestHit.origin) };
 
 			//Calculate BRDF
+			RAYTRACER_STAT_INC(ShadingCalls);
 			ColorRGB BRDF{ materials[closestHit.materialIndex]->Shade(closestHit, directionToLight.Normalized(), -rayDirection) };
 
 			switch (m_CurrentLightingMode)
@@ -165,6 +303,7 @@ void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float
 				finalColor += BRDF;
 				break;
 			case LightingMode::Combined:
+			case LightingMode::Cost: //Shaded like Combined, so the measured shading time is the real one
 				if (observerdArea >= 0)
 				{
 					finalColor += radiance * BRDF * observerdArea;
@@ -177,15 +316,245 @@ void Renderer::RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float
 	//Update Color in Buffer
 	finalColor.MaxToOne();
 
-	m_pBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBuffer->format,
-		static_cast<uint8_t>(finalColor.r * 255),
-		static_cast<uint8_t>(finalColor.g * 255),
-		static_cast<uint8_t>(finalColor.b * 255));
+	m_pBufferPixels[px + (py * m_Width)] = 0xFF000000u
+		| static_cast<uint32_t>(static_cast<uint8_t>(finalColor.r * 255)) << 16
+		| static_cast<uint32_t>(static_cast<uint8_t>(finalColor.g * 255)) << 8
+		| static_cast<uint32_t>(static_cast<uint8_t>(finalColor.b * 255));
+
+	return shadowRayCount;
+}
+
+bool Renderer::SaveBufferToImage(const std::string& filePath) const
+{
+	std::ofstream file{ filePath, std::ios::binary };
+	if (!file)
+		return false;
+
+	const uint32_t headerSize{ 14 + 40 };
+	const uint32_t imageSize{ static_cast<uint32_t>(m_Width * m_Height * 4) };
+
+	//BMP headers are little endian
+	const auto write = [&file](uint32_t value, int byteCount)
+		{
+			for (int byte{ 0 }; byte < byteCount; ++byte)
+			{
+				file.put(static_cast<char>((value >> (byte * 8)) & 0xFF));
+			}
+		};
+
+	//File header
+	file.put('B');
+	file.put('M');
+	write(headerSize + imageSize, 4);
+	write(0, 4); //Reserved
+	write(headerSize, 4); //Offset to the pixels
+
+	//Info header, 32 bit uncompressed, rows stored bottom to top
+	write(40, 4);
+	write(static_cast<uint32_t>(m_Width), 4);
+	write(static_cast<uint32_t>(m_Height), 4);
+	write(1, 2); //Planes
+	write(32, 2); //Bits per pixel
+	write(0, 4); //Compression (BI_RGB)
+	write(imageSize, 4);
+	write(2835, 4); //72 DPI horizontal
+	write(2835, 4); //72 DPI vertical
+	write(0, 4); //Palette colors
+	write(0, 4); //Important colors
+
+	//0xAARRGGBB written little endian is the B, G, R, A byte order BMP expects
+	for (int py{ m_Height - 1 }; py >= 0; --py)
+	{
+		for (int px{ 0 }; px < m_Width; ++px)
+		{
+			write(m_pBufferPixels[px + py * m_Width], 4);
+		}
+	}
+
+	return file.good();
+}
+
+bool Renderer::SavePixelCostsToImage(CostChannel channel, const std::string& filePath) const
+{
+	if (m_PixelCosts.empty() || !IsCostChannelAvailable(channel))
+		return false;
+
+	std::ofstream file{ filePath, std::ios::binary };
+	if (!file)
+		return false;
+
+	//Grayscale PFM, a negative scale marks little endian floats, rows stored bottom to top
+	file << "Pf\n" << m_Width << ' ' << m_Height << "\n-1.0\n";
+
+	for (int py{ m_Height - 1 }; py >= 0; --py)
+	{
+		for (int px{ 0 }; px < m_Width; ++px)
+		{
+			const uint32_t value{ std::bit_cast<uint32_t>(GetPixelCost(m_PixelCosts[px + py * m_Width], channel)) };
+			for (int byte{ 0 }; byte < 4; ++byte)
+			{
+				file.put(static_cast<char>((value >> (byte * 8)) & 0xFF));
+			}
+		}
+	}
+
+	return file.good();
+}
+
+float Renderer::GetPixelCost(const PixelCost& pixelCost, CostChannel channel)
+{
+	switch (channel)
+	{
+	case CostChannel::NodeVisits:
+		return static_cast<float>(pixelCost.nodeVisits);
+	case CostChannel::PrimitiveTests:
+		return static_cast<float>(pixelCost.primitiveTests);
+	case CostChannel::ShadowRays:
+		return static_cast<float>(pixelCost.shadowRays);
+	case CostChannel::ShadingTime:
+		return pixelCost.shadingTime;
+	}
+	return 0.f;
+}
+
+void Renderer::DrawCostHeatmap() const
+{
+	std::vector<float> costs(m_PixelCosts.size());
+	for (size_t i{ 0 }; i < m_PixelCosts.size(); ++i)
+	{
+		costs[i] = GetPixelCost(m_PixelCosts[i], m_HeatmapChannel);
+	}
+
+	//Scaled to the 99th percentile, so a few outliers do not turn the rest of the image dark
+	std::vector<float> sortedCosts{ costs };
+	const auto percentile = sortedCosts.begin() + (sortedCosts.size() * 99) / 100;
+	std::nth_element(sortedCosts.begin(), percentile, sortedCosts.end());
+	const float maxCost{ std::max(*percentile, FLT_MIN) };
+
+	//Black for no work, then blue, cyan, green, yellow and red for the most expensive pixels
+	const ColorRGB gradient[]{ { 0.f, 0.f, 0.f }, { 0.f, 0.f, 1.f }, { 0.f, 1.f, 1.f }, { 0.f, 1.f, 0.f }, { 1.f, 1.f, 0.f }, { 1.f, 0.f, 0.f } };
+	constexpr int lastStop{ static_cast<int>(std::size(gradient)) - 1 };
+
+	for (size_t i{ 0 }; i < costs.size(); ++i)
+	{
+		const float position{ std::min(costs[i] / maxCost, 1.f) * lastStop };
+		const int stop{ std::min(static_cast<int>(position), lastStop - 1) };
+		const float blend{ position - stop };
+		const ColorRGB color{ gradient[stop] * (1.f - blend) + gradient[stop + 1] * blend };
+
+		m_pBufferPixels[i] = 0xFF000000u
+			| static_cast<uint32_t>(static_cast<uint8_t>(color.r * 255)) << 16
+			| static_cast<uint32_t>(static_cast<uint8_t>(color.g * 255)) << 8
+			| static_cast<uint32_t>(static_cast<uint8_t>(color.b * 255));
+	}
+}
+
+uint32_t Renderer::GetThreadCount() const
+{
+	return m_pThreadPool->GetThreadCount();
+}
+
+StatBlock Renderer::GetStats() const
+{
+	StatBlock stats{};
+	for (const StatBlock& tileStats : m_TileStats)
+	{
+		stats += tileStats;
+	}
+	return stats;
+}
+
+uint64_t Renderer::GetRayCount() const
+{
+	uint64_t rayCount{ 0 };
+	for (uint32_t tileRayCount : m_TileRayCounts)
+	{
+		rayCount += tileRayCount;
+	}
+	return rayCount;
+}
+
+void Renderer::TogglePacketTracing()
+{
+	m_PacketTracingEnabled = !m_PacketTracingEnabled;
+	std::cout << (m_PacketTracingEnabled ? "Packet tracing ON\n" : "Packet tracing OFF\n");
+}
+
+void Renderer::CycleExecutionMode()
+{
+	switch (m_ExecutionMode)
+	{
+	case ExecutionMode::Synchronous:
+		m_ExecutionMode = ExecutionMode::Async;
+		std::cout << "Async (" << m_pThreadPool->GetThreadCount() << " threads)\n";
+		break;
+	case ExecutionMode::Async:
+		m_ExecutionMode = ExecutionMode::ParallelFor;
+		std::cout << "ParallelFor (" << m_pThreadPool->GetThreadCount() << " threads)\n";
+		break;
+	case ExecutionMode::ParallelFor:
+		m_ExecutionMode = ExecutionMode::WorkStealing;
+		std::cout << "WorkStealing (" << m_pThreadPool->GetThreadCount() << " threads)\n";
+		break;
+	case ExecutionMode::WorkStealing:
+		m_ExecutionMode = ExecutionMode::Synchronous;
+		std::cout << "Synchronous\n";
+		break;
+	}
+}
+
+void Renderer::SetTileSize(int tileSize)
+{
+	m_TileSize = std::max(tileSize, 1);
+	UpdateTileOrder();
+}
+
+void Renderer::UpdateTileOrder()
+{
+	const uint32_t tilesPerRow = (m_Width + m_TileSize - 1) / m_TileSize;
+	const uint32_t tilesPerColumn = (m_Height + m_TileSize - 1) / m_TileSize;
+
+	m_TileOrder.resize(tilesPerRow * tilesPerColumn);
+	m_TileCosts.assign(m_TileOrder.size(), 0.f);
+	m_TileRayCounts.assign(m_TileOrder.size(), 0);
+	m_TileStats.assign(m_TileOrder.size(), StatBlock{});
+	for (uint32_t tileIndex{ 0 }; tileIndex < m_TileOrder.size(); ++tileIndex)
+	{
+		m_TileOrder[tileIndex] = tileIndex;
+	}
+
+	const auto mortonCode = [tilesPerRow](uint32_t tileIndex)
+		{
+			return MortonEncode2D(static_cast<uint16_t>(tileIndex % tilesPerRow), static_cast<uint16_t>(tileIndex / tilesPerRow));
+		};
+	std::sort(m_TileOrder.begin(), m_TileOrder.end(), [&](uint32_t a, uint32_t b) { return mortonCode(a) < mortonCode(b); });
 }
 
-bool Renderer::SaveBufferToImage() const
+std::vector<std::vector<uint32_t>> Renderer::AssignTiles(uint32_t threadCount) const
 {
-	return SDL_SaveBMP(m_pBuffer, "RayTracing_Buffer.bmp");
+	float totalCost{ 0.f };
+	for (float cost : m_TileCosts)
+	{
+		totalCost += cost;
+	}
+
+	//Without a previous frame every tile is assumed to cost the same
+	const bool hasCosts{ totalCost > 0.f };
+	if (!hasCosts)
+		totalCost = static_cast<float>(m_TileCosts.size());
+
+	//Consecutive Morton tiles stay on one thread, so each thread renders a compact area of the screen
+	std::vector<std::vector<uint32_t>> tilesPerThread(threadCount);
+	float accumulatedCost{ 0.f };
+	for (uint32_t taskIndex{ 0 }; taskIndex < m_TileCosts.size(); ++taskIndex)
+	{
+		const float cost{ hasCosts ? m_TileCosts[taskIndex] : 1.f };
+		const float center{ (accumulatedCost + cost * 0.5f) / totalCost };
+		const uint32_t threadIndex{ std::min(static_cast<uint32_t>(center * threadCount), threadCount - 1) };
+		tilesPerThread[threadIndex].push_back(taskIndex);
+		accumulatedCost += cost;
+	}
+	return tilesPerThread;
 }
 
 void Renderer::CycleLightingMode()
@@ -206,6 +575,36 @@ void Renderer::CycleLightingMode()
 		std::cout << "BRDF\n";
 	}
 	else if (m_CurrentLightingMode == LightingMode::BRDF)
+	{
+		m_CurrentLightingMode = LightingMode::Cost;
+		if (IsCostChannelAvailable(CostChannel::NodeVisits))
+		{
+			m_HeatmapChannel = CostChannel::NodeVisits;
+			std::cout << "Cost: BVH node visits\n";
+		}
+		else
+		{
+			//Node visits and primitive tests would only show zeros
+			m_HeatmapChannel = CostChannel::ShadowRays;
+			std::cout << "Cost: shadow rays (node visits and primitive tests need RAYTRACER_ENABLE_STATS)\n";
+		}
+	}
+	else if (m_HeatmapChannel == CostChannel::NodeVisits)
+	{
+		m_HeatmapChannel = CostChannel::PrimitiveTests;
+		std::cout << "Cost: primitive tests\n";
+	}
+	else if (m_HeatmapChannel == CostChannel::PrimitiveTests)
+	{
+		m_HeatmapChannel = CostChannel::ShadowRays;
+		std::cout << "Cost: shadow rays\n";
+	}
+	else if (m_HeatmapChannel == CostChannel::ShadowRays)
+	{
+		m_HeatmapChannel = CostChannel::ShadingTime;
+		std::cout << "Cost: shading time\n";
+	}
+	else
 	{
 		m_CurrentLightingMode = LightingMode::Combined;
 		std::cout << "Combined\n";
@@ -2,22 +2,39 @@
 
 #include <cstdint>
 #include "Camera.h"
+#include <memory>
+#include <string>
 #include <vector>
 #include "DataTypes.h"
 #include "Material.h"
-
-struct SDL_Window;
-struct SDL_Surface;
+#include "Stats.h"
 
 namespace dae
 {
 	class Scene;
+	class ThreadPool;
 
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow);
-		~Renderer() = default;
+		//Per pixel work measured for the cost view and SavePixelCostsToImage
+		enum class CostChannel
+		{
+			NodeVisits, //BVH nodes visited by the primary and shadow rays, needs RAYTRACER_ENABLE_STATS
+			PrimitiveTests, //Spheres, triangles and planes tested, needs RAYTRACER_ENABLE_STATS
+			ShadowRays, //Shadow rays traced
+			ShadingTime //Nanoseconds spent shading, shadow rays included
+		};
+
+		/**
+		 * \brief Renderer writing into a buffer owned by the caller, the buffer has to outlive the renderer
+		 * \param pBufferPixels width * height pixels, row by row, written as 0xAARRGGBB with an opaque alpha
+		 * \param width pixels per row
+		 * \param height amount of rows
+		 * \param threadCount render threads including the calling thread, 0 uses every hardware thread
+		 */
+		Renderer(uint32_t* pBufferPixels, int width, int height, uint32_t threadCount = 0);
+		~Renderer();
 
 		Renderer(const Renderer&) = delete;
 		Renderer(Renderer&&) noexcept = delete;
@@ -26,19 +43,49 @@ namespace dae
 
 		void Render(Scene* pScene) const;
 
-		void RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, 
-			const Camera& camera, const std::vector<Light>& lights, const std::vector<Material*>& materials) const;
+		//The Render* functions return the amount of rays they traced, primary and shadow rays
+		//Renders one m_TileSize x m_TileSize block of the screen, tileIndex counts tiles row by row
+		uint32_t RenderTile(Scene* pScene, uint32_t tileIndex, float fov, float aspectRatio,
+			const Camera& camera, const std::vector<Material*>& materials) const;
+		uint32_t RenderPixel(Scene* pScene, uint32_t pixelIndex, float fov, float aspectRatio, 
+			const Camera& camera, const std::vector<Material*>& materials) const;
+		//Traces the primary rays of the pixels in [startX, endX) x [startY, endY) as one packet, at most m_PacketSize per side
+		uint32_t RenderPacket(Scene* pScene, int startX, int startY, int endX, int endY, float fov, float aspectRatio,
+			const Camera& camera, const std::vector<Material*>& materials) const;
+
+		//Writes the buffer as a 32 bit BMP, returns true when the file was written
+		bool SaveBufferToImage(const std::string& filePath = "RayTracing_Buffer.bmp") const;
+		//Writes one channel of the last frame's pixel costs as a grayscale float PFM
+		//Returns false when the file could not be written, the last frame collected no costs or the channel is not available
+		bool SavePixelCostsToImage(CostChannel channel, const std::string& filePath) const;
+		//Node visits and primitive tests are read from the stats counters, a build without RAYTRACER_ENABLE_STATS does not measure them
+		static constexpr bool IsCostChannelAvailable(CostChannel channel)
+		{
+			return RAYTRACER_ENABLE_STATS || (channel != CostChannel::NodeVisits && channel != CostChannel::PrimitiveTests);
+		}
 
-		bool SaveBufferToImage() const;
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+		uint32_t GetThreadCount() const;
+		//Primary and shadow rays traced by the last Render call
+		uint64_t GetRayCount() const;
+		//Every pixel traces one primary ray, the rest of GetRayCount are shadow rays
+		uint64_t GetPrimaryRayCount() const { return uint64_t(m_Width) * m_Height; }
+		//Hot path counters of the last Render call merged over every tile, all zero without RAYTRACER_ENABLE_STATS
+		StatBlock GetStats() const;
 
 		void CycleLightingMode();
+		//Collects the pixel costs without showing the cost view, the cost view always collects them
+		//Collecting traces every pixel on its own, so costs are not shared by the pixels of a packet
+		void SetCostCollectionEnabled(bool isEnabled) { m_CostCollectionEnabled = isEnabled; }
 		void ToggleShadows() { m_ShadowsEnabled = !m_ShadowsEnabled; }
+		void TogglePacketTracing();
+		void CycleExecutionMode();
+		//Pixels per side of a tile, multiples of the packet size keep every packet full
+		void SetTileSize(int tileSize);
 
 
 	private:
-		SDL_Window* m_pWindow{};
-
-		SDL_Surface* m_pBuffer{};
 		uint32_t* m_pBufferPixels{};
 
 		int m_Width{};
@@ -49,10 +96,62 @@ namespace dae
 			ObservedArea, //Lambert Cosine Law
 			Radiance, //Incident Radiance
 			BRDF, //Scattering of the light
-			Combined //ObservedArea*Radiance*BRDF
+			Combined, //ObservedArea*Radiance*BRDF
+			Cost //Heatmap of m_HeatmapChannel
+		};
+
+		enum class ExecutionMode
+		{
+			Synchronous, //No threading
+			Async, //One std::async task per core, each with an equal share of the tiles
+			ParallelFor, //Persistent thread pool, threads claim tiles one by one
+			WorkStealing //Persistent thread pool, tiles split by last frame's cost and stolen by idle threads
 		};
 
 		LightingMode m_CurrentLightingMode{ LightingMode::Combined };
+		ExecutionMode m_ExecutionMode{ ExecutionMode::WorkStealing };
 		bool m_ShadowsEnabled{ true };
+		bool m_PacketTracingEnabled{ true };
+		bool m_CostCollectionEnabled{ false };
+		CostChannel m_HeatmapChannel{ CostChannel::NodeVisits };
+
+		struct PixelCost
+		{
+			uint32_t nodeVisits{};
+			uint32_t primitiveTests{};
+			uint32_t shadowRays{};
+			float shadingTime{};
+		};
+		//Cost of every pixel of the last frame, empty when the frame collected no costs
+		mutable std::vector<PixelCost> m_PixelCosts{};
+
+		//Pixels per side of a primary ray packet, m_PacketSize * m_PacketSize rays fit in a RayPacket
+		static constexpr int m_PacketSize{ 8 };
+
+		int m_TileSize{ 32 };
+		//Row by row tile indices in Morton order, so consecutive jobs render neighbouring tiles
+		std::vector<uint32_t> m_TileOrder{};
+		//Seconds each tile took last frame, indexed like m_TileOrder, every tile is only written by the thread rendering it
+		mutable std::vector<float> m_TileCosts{};
+		//Rays each tile traced last frame, indexed like m_TileOrder
+		mutable std::vector<uint32_t> m_TileRayCounts{};
+		//Counters each tile added last frame, indexed like m_TileOrder, padded blocks so threads never write to the same cache line
+		mutable std::vector<StatBlock> m_TileStats{};
+
+		std::unique_ptr<ThreadPool> m_pThreadPool{};
+
+		bool IsCollectingCosts() const { return m_CostCollectionEnabled || m_CurrentLightingMode == LightingMode::Cost; }
+		static float GetPixelCost(const PixelCost& pixelCost, CostChannel channel);
+		//Overwrites the buffer with a false color heatmap of m_HeatmapChannel
+		void DrawCostHeatmap() const;
+
+		void UpdateTileOrder();
+		//Splits m_TileOrder into one contiguous run per thread with about the same predicted cost
+		std::vector<std::vector<uint32_t>> AssignTiles(uint32_t threadCount) const;
+
+		Vector3 GetViewRayDirection(int px, int py, float fov, float aspectRatio, const Camera& camera) const;
+		//Returns the amount of shadow rays traced
+		uint32_t ShadePixel(Scene* pScene, int px, int py, const Vector3& rayDirection, const HitRecord& closestHit,
+			const std::vector<Material*>& materials) const;
 	};
 }
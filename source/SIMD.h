@@ -0,0 +1,165 @@
+#pragma once
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+//Instruction set selection for the SIMD kernels
+//SSE2 is part of every x64 target, AVX2 is used when the compiler targets it (/arch:AVX2, -mavx2)
+//Other targets fall back to scalar loops over the lanes
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RAYTRACER_SSE
+#include <immintrin.h>
+#endif
+
+#if defined(RAYTRACER_SSE) && defined(__AVX2__)
+#define RAYTRACER_AVX2
+#endif
+
+namespace dae
+{
+#pragma region SimdFloat
+	//Thin wrapper around the widest float register available, so kernels are written once for every instruction set
+	//Comparisons return lane masks (all bits set or cleared) in a SimdFloat
+#if defined(RAYTRACER_AVX2)
+	constexpr int SimdWidth{ 8 };
+
+	struct SimdFloat
+	{
+		__m256 v;
+	};
+
+	inline SimdFloat SimdSet(float f) { return { _mm256_set1_ps(f) }; }
+	inline SimdFloat SimdLoad(const float* p) { return { _mm256_loadu_ps(p) }; }
+	inline void SimdStore(float* p, SimdFloat a) { _mm256_storeu_ps(p, a.v); }
+
+	inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return { _mm256_add_ps(a.v, b.v) }; }
+	inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	inline SimdFloat operator/(SimdFloat a, SimdFloat b) { return { _mm256_div_ps(a.v, b.v) }; }
+	inline SimdFloat operator<(SimdFloat a, SimdFloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	inline SimdFloat operator>(SimdFloat a, SimdFloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	inline SimdFloat operator<=(SimdFloat a, SimdFloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+	inline SimdFloat operator>=(SimdFloat a, SimdFloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ) }; }
+	inline SimdFloat operator&(SimdFloat a, SimdFloat b) { return { _mm256_and_ps(a.v, b.v) }; }
+	inline SimdFloat operator|(SimdFloat a, SimdFloat b) { return { _mm256_or_ps(a.v, b.v) }; }
+
+	inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return { _mm256_min_ps(a.v, b.v) }; }
+	inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return { _mm256_max_ps(a.v, b.v) }; }
+	inline SimdFloat SimdSqrt(SimdFloat a) { return { _mm256_sqrt_ps(a.v) }; }
+	//mask ? a : b
+	inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+	//One bit per lane
+	inline int SimdMoveMask(SimdFloat mask) { return _mm256_movemask_ps(mask.v); }
+	//Mask of the first count lanes
+	inline SimdFloat SimdLaneMask(int count)
+	{
+		return { _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))) };
+	}
+
+#elif defined(RAYTRACER_SSE)
+	constexpr int SimdWidth{ 4 };
+
+	struct SimdFloat
+	{
+		__m128 v;
+	};
+
+	inline SimdFloat SimdSet(float f) { return { _mm_set1_ps(f) }; }
+	inline SimdFloat SimdLoad(const float* p) { return { _mm_loadu_ps(p) }; }
+	inline void SimdStore(float* p, SimdFloat a) { _mm_storeu_ps(p, a.v); }
+
+	inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline SimdFloat operator/(SimdFloat a, SimdFloat b) { return { _mm_div_ps(a.v, b.v) }; }
+	inline SimdFloat operator<(SimdFloat a, SimdFloat b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+	inline SimdFloat operator>(SimdFloat a, SimdFloat b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+	inline SimdFloat operator<=(SimdFloat a, SimdFloat b) { return { _mm_cmple_ps(a.v, b.v) }; }
+	inline SimdFloat operator>=(SimdFloat a, SimdFloat b) { return { _mm_cmpge_ps(a.v, b.v) }; }
+	inline SimdFloat operator&(SimdFloat a, SimdFloat b) { return { _mm_and_ps(a.v, b.v) }; }
+	inline SimdFloat operator|(SimdFloat a, SimdFloat b) { return { _mm_or_ps(a.v, b.v) }; }
+
+	inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return { _mm_min_ps(a.v, b.v) }; }
+	inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return { _mm_max_ps(a.v, b.v) }; }
+	inline SimdFloat SimdSqrt(SimdFloat a) { return { _mm_sqrt_ps(a.v) }; }
+	//mask ? a : b (SSE2 has no blendv)
+	inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+	//One bit per lane
+	inline int SimdMoveMask(SimdFloat mask) { return _mm_movemask_ps(mask.v); }
+	//Mask of the first count lanes
+	inline SimdFloat SimdLaneMask(int count)
+	{
+		return { _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_set1_epi32(count), _mm_setr_epi32(0, 1, 2, 3))) };
+	}
+
+#else
+	constexpr int SimdWidth{ 4 };
+
+	struct SimdFloat
+	{
+		float v[4];
+	};
+
+	namespace SimdScalar
+	{
+		inline float Mask(bool b) { return std::bit_cast<float>(b ? 0xFFFFFFFFu : 0u); }
+		inline uint32_t Bits(float f) { return std::bit_cast<uint32_t>(f); }
+
+		template<typename Func>
+		inline SimdFloat Apply(SimdFloat a, SimdFloat b, Func&& func)
+		{
+			SimdFloat result{};
+			for (int lane{ 0 }; lane < 4; ++lane)
+				result.v[lane] = func(a.v[lane], b.v[lane]);
+			return result;
+		}
+	}
+
+	inline SimdFloat SimdSet(float f) { return { f, f, f, f }; }
+	inline SimdFloat SimdLoad(const float* p) { return { p[0], p[1], p[2], p[3] }; }
+	inline void SimdStore(float* p, SimdFloat a) { for (int lane{ 0 }; lane < 4; ++lane) p[lane] = a.v[lane]; }
+
+	inline SimdFloat operator+(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x + y; }); }
+	inline SimdFloat operator-(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x - y; }); }
+	inline SimdFloat operator*(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x * y; }); }
+	inline SimdFloat operator/(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x / y; }); }
+	inline SimdFloat operator<(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::Mask(x < y); }); }
+	inline SimdFloat operator>(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::Mask(x > y); }); }
+	inline SimdFloat operator<=(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::Mask(x <= y); }); }
+	inline SimdFloat operator>=(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return SimdScalar::Mask(x >= y); }); }
+	inline SimdFloat operator&(SimdFloat a, SimdFloat b)
+	{
+		return SimdScalar::Apply(a, b, [](float x, float y) { return std::bit_cast<float>(SimdScalar::Bits(x) & SimdScalar::Bits(y)); });
+	}
+	inline SimdFloat operator|(SimdFloat a, SimdFloat b)
+	{
+		return SimdScalar::Apply(a, b, [](float x, float y) { return std::bit_cast<float>(SimdScalar::Bits(x) | SimdScalar::Bits(y)); });
+	}
+
+	inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x < y ? x : y; }); }
+	inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return SimdScalar::Apply(a, b, [](float x, float y) { return x > y ? x : y; }); }
+	inline SimdFloat SimdSqrt(SimdFloat a) { return SimdScalar::Apply(a, a, [](float x, float) { return std::sqrt(x); }); }
+	//mask ? a : b
+	inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b)
+	{
+		SimdFloat result{};
+		for (int lane{ 0 }; lane < 4; ++lane)
+			result.v[lane] = SimdScalar::Bits(mask.v[lane]) ? a.v[lane] : b.v[lane];
+		return result;
+	}
+	//One bit per lane
+	inline int SimdMoveMask(SimdFloat mask)
+	{
+		int bits{ 0 };
+		for (int lane{ 0 }; lane < 4; ++lane)
+			bits |= (SimdScalar::Bits(mask.v[lane]) >> 31) << lane;
+		return bits;
+	}
+	//Mask of the first count lanes
+	inline SimdFloat SimdLaneMask(int count)
+	{
+		return { SimdScalar::Mask(count > 0), SimdScalar::Mask(count > 1), SimdScalar::Mask(count > 2), SimdScalar::Mask(count > 3) };
+	}
+#endif
+#pragma endregion
+}
@@ -1,6 +1,10 @@
 #include "Scene.h"
 #include "Utils.h"
+#include "OBJParser.h"
+#include "MeshCache.h"
 #include "Material.h"
+#include "SceneFile.h"
+#include "SceneSnapshot.h"
 
 namespace dae {
 
@@ -12,6 +16,7 @@ namespace dae {
 		m_SphereGeometries.reserve(32);
 		m_PlaneGeometries.reserve(32);
 		m_TriangleMeshGeometries.reserve(32);
+		m_TriangleMeshInstances.reserve(32);
 		m_Lights.reserve(32);
 	}
 
@@ -26,38 +31,161 @@ namespace dae {
 		m_Materials.clear();
 	}
 
-	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
+	void Scene::UpdateAccelerationStructure()
 	{
-		HitRecord hitRecordTestHit{}, hitRecordClosestHit{};
-		hitRecordClosestHit.t = ray.max;
+		if (m_IsTopLevelDirty)
+		{
+			BuildTopLevel();
+			return;
+		}
 
-		for (const Sphere& sphere : m_SphereGeometries)
+		//Only meshes and instances can move after they are added, refit when any of them changed since the last update
+		bool didMove{ false };
+		for (uint32_t i{ 0 }; i < m_BoundedGeometries.size(); ++i)
 		{
-			GeometryUtils::HitTest_Sphere(sphere, ray, hitRecordTestHit);
-			if (hitRecordTestHit.t < hitRecordClosestHit.t)
+			BoundedGeometry& geometry = m_BoundedGeometries[i];
+
+			uint32_t transformRevision{};
+			switch (geometry.type)
 			{
-				hitRecordClosestHit = hitRecordTestHit;
+			case GeometryType::Spheres:
+				continue;
+			case GeometryType::TriangleMesh:
+				transformRevision = m_TriangleMeshGeometries[geometry.index].transformRevision;
+				break;
+			case GeometryType::TriangleMeshInstance:
+				transformRevision = m_TriangleMeshInstances[geometry.index].transformRevision;
+				break;
+			}
+
+			if (geometry.transformRevision != transformRevision)
+			{
+				geometry.transformRevision = transformRevision;
+				m_BoundedGeometryBounds[i] = GetBounds(geometry);
+				didMove = true;
 			}
 		}
 
-		for (const Plane& plane : m_PlaneGeometries)
+		if (didMove)
 		{
-			GeometryUtils::HitTest_Plane(plane, ray, hitRecordTestHit);
-			if (hitRecordTestHit.t < hitRecordClosestHit.t)
+			m_TopLevelBVH.Update(m_BoundedGeometryBounds);
+		}
+	}
+
+	void Scene::BuildTopLevel()
+	{
+		m_BoundedGeometries.clear();
+		m_BoundedGeometries.reserve(1 + m_TriangleMeshGeometries.size() + m_TriangleMeshInstances.size());
+
+		//Spheres can't move once added, their BVH and blocks are only rebuilt together with the top level after spheres changed
+		if (m_AreSpheresDirty)
+		{
+			m_SphereBVH.Clear();
+			if (!m_SphereGeometries.empty())
 			{
-				hitRecordClosestHit = hitRecordTestHit;
+				std::vector<AABB> sphereBounds{};
+				sphereBounds.reserve(m_SphereGeometries.size());
+				for (const Sphere& sphere : m_SphereGeometries)
+				{
+					const Vector3 extent{ sphere.radius, sphere.radius, sphere.radius };
+					sphereBounds.push_back(AABB{ sphere.origin - extent, sphere.origin + extent });
+				}
+
+				m_SphereBVH.SetMaxLeafSize(SphereSoA::BlockSize);
+				m_SphereBVH.Build(sphereBounds);
+				m_Spheres.Build(m_SphereGeometries, m_SphereBVH.GetPrimitiveIndices());
 			}
+			m_AreSpheresDirty = false;
 		}
 
-		for (const TriangleMesh& triangleMesh : m_TriangleMeshGeometries)
+		if (!m_SphereGeometries.empty())
 		{
-			GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray, hitRecordTestHit);
-			if (hitRecordTestHit.t < hitRecordClosestHit.t)
+			m_BoundedGeometries.push_back({ GeometryType::Spheres, 0 });
+		}
+
+		for (uint32_t i{ 0 }; i < m_TriangleMeshGeometries.size(); ++i)
+		{
+			m_BoundedGeometries.push_back({ GeometryType::TriangleMesh, i, m_TriangleMeshGeometries[i].transformRevision });
+		}
+
+		for (uint32_t i{ 0 }; i < m_TriangleMeshInstances.size(); ++i)
+		{
+			m_BoundedGeometries.push_back({ GeometryType::TriangleMeshInstance, i, m_TriangleMeshInstances[i].transformRevision });
+		}
+
+		m_BoundedGeometryBounds.clear();
+		m_BoundedGeometryBounds.reserve(m_BoundedGeometries.size());
+		for (const BoundedGeometry& geometry : m_BoundedGeometries)
+		{
+			m_BoundedGeometryBounds.push_back(GetBounds(geometry));
+		}
+
+		m_TopLevelBVH.Build(m_BoundedGeometryBounds);
+		m_IsTopLevelDirty = false;
+	}
+
+	AABB Scene::GetBounds(const BoundedGeometry& geometry) const
+	{
+		switch (geometry.type)
+		{
+		case GeometryType::Spheres:
+		{
+			const BVHNode& root = m_SphereBVH.GetNodes()[0];
+			return AABB{ root.minAABB, root.maxAABB };
+		}
+		case GeometryType::TriangleMesh:
+			return m_TriangleMeshGeometries[geometry.index].GetBounds();
+		case GeometryType::TriangleMeshInstance:
+			return m_TriangleMeshInstances[geometry.index].worldBounds;
+		}
+
+		return AABB{};
+	}
+
+	void dae::Scene::GetClosestHit(const Ray& ray, HitRecord& closestHit) const
+	{
+		HitRecord hitRecordTestHit{}, hitRecordClosestHit{};
+		hitRecordClosestHit.t = ray.max;
+
+		//Every hit shrinks the ray, so the top level traversal can skip everything behind it
+		Ray closestRay{ ray };
+
+		RAYTRACER_STAT_ADD(PrimitiveTests, m_PlaneGeometries.size());
+		for (const Plane& plane : m_PlaneGeometries)
+		{
+			if (GeometryUtils::HitTest_Plane(plane, closestRay, hitRecordTestHit))
 			{
+				closestRay.max = hitRecordTestHit.t;
 				hitRecordClosestHit = hitRecordTestHit;
 			}
 		}
 
+		GeometryUtils::TraverseBVH(m_TopLevelBVH, closestRay, [&](uint32_t geometryIndex, Ray& testRay)
+			{
+				const BoundedGeometry& geometry = m_BoundedGeometries[geometryIndex];
+
+				bool didHit{ false };
+				switch (geometry.type)
+				{
+				case GeometryType::Spheres:
+					didHit = GeometryUtils::HitTest_Spheres(m_SphereBVH, m_Spheres, testRay, hitRecordTestHit);
+					break;
+				case GeometryType::TriangleMesh:
+					didHit = GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[geometry.index], testRay, hitRecordTestHit);
+					break;
+				case GeometryType::TriangleMeshInstance:
+					didHit = GeometryUtils::HitTest_TriangleMeshInstance(m_TriangleMeshInstances[geometry.index], testRay, hitRecordTestHit);
+					break;
+				}
+
+				if (didHit)
+				{
+					testRay.max = hitRecordTestHit.t;
+					hitRecordClosestHit = hitRecordTestHit;
+				}
+				return false;
+			});
+
 	/*	for (const Triangle& triangle : m_Triangles)
 		{
 			GeometryUtils::HitTest_Triangle(triangle, ray, hitRecordTestHit);
@@ -71,41 +199,91 @@ namespace dae {
 		return;
 	}
 
-	bool Scene::DoesHit(const Ray& ray) const
+	void Scene::GetClosestHits(RayPacket& packet, HitRecord* closestHits) const
 	{
-		for (const Sphere& sphere : m_SphereGeometries)
+		HitRecord hitRecordTestHit{};
+
+		//Planes are tested per ray, their hits shrink the rays before the packet traversal
+		for (uint32_t rayIndex{ 0 }; rayIndex < packet.size; ++rayIndex)
 		{
-			if (GeometryUtils::HitTest_Sphere(sphere, ray))
+			closestHits[rayIndex] = HitRecord{};
+			closestHits[rayIndex].t = packet.max[rayIndex];
+
+			Ray closestRay{ packet.GetRay(rayIndex) };
+			RAYTRACER_STAT_ADD(PrimitiveTests, m_PlaneGeometries.size());
+			for (const Plane& plane : m_PlaneGeometries)
 			{
-				return true;
+				if (GeometryUtils::HitTest_Plane(plane, closestRay, hitRecordTestHit))
+				{
+					closestRay.max = hitRecordTestHit.t;
+					closestHits[rayIndex] = hitRecordTestHit;
+				}
 			}
+			packet.max[rayIndex] = closestRay.max;
 		}
 
+		const std::span<const uint32_t> geometryIndices{ m_TopLevelBVH.GetPrimitiveIndices() };
+		GeometryUtils::TraversePacketBVHLeaves(m_TopLevelBVH, packet, packet.GetFullMask(), [&](uint32_t first, uint32_t count, uint64_t rayMask)
+			{
+				for (uint32_t i{ 0 }; i < count; ++i)
+				{
+					const BoundedGeometry& geometry = m_BoundedGeometries[geometryIndices[first + i]];
+
+					switch (geometry.type)
+					{
+					case GeometryType::Spheres:
+						GeometryUtils::HitTest_SpheresPacket(m_SphereBVH, m_Spheres, packet, rayMask, closestHits);
+						break;
+					case GeometryType::TriangleMesh:
+						GeometryUtils::HitTest_TriangleMeshPacket(m_TriangleMeshGeometries[geometry.index], packet, rayMask, closestHits);
+						break;
+					case GeometryType::TriangleMeshInstance:
+						GeometryUtils::HitTest_TriangleMeshInstancePacket(m_TriangleMeshInstances[geometry.index], packet, rayMask, closestHits);
+						break;
+					}
+				}
+			});
+	}
+
+	bool Scene::IsOccluded(const Ray& ray) const
+	{
 		for (const Plane& plane : m_PlaneGeometries)
 		{
+			RAYTRACER_STAT_INC(PrimitiveTests);
 			if (GeometryUtils::HitTest_Plane(plane, ray))
 			{
 				return true;
 			}
 		}
 
-		for (const TriangleMesh& triangleMesh : m_TriangleMeshGeometries)
-		{
-			if (GeometryUtils::HitTest_TriangleMesh(triangleMesh, ray))
+		const std::span<const uint32_t> geometryIndices{ m_TopLevelBVH.GetPrimitiveIndices() };
+		return GeometryUtils::TraverseBVHLeavesOcclusion(m_TopLevelBVH, ray, [&](uint32_t first, uint32_t count)
 			{
-				return true;
-			}
-		}
-
-		//for (const Triangle& triangle : m_Triangles)
-		//{
-		//	if (GeometryUtils::HitTest_Triangle(triangle, ray))
-		//	{
-		//		return true;
-		//	}
-		//}
-
-		return false;
+				for (uint32_t i{ 0 }; i < count; ++i)
+				{
+					const BoundedGeometry& geometry = m_BoundedGeometries[geometryIndices[first + i]];
+
+					bool didHit{ false };
+					switch (geometry.type)
+					{
+					case GeometryType::Spheres:
+						didHit = GeometryUtils::HitTest_Spheres(m_SphereBVH, m_Spheres, ray);
+						break;
+					case GeometryType::TriangleMesh:
+						didHit = GeometryUtils::HitTest_TriangleMesh(m_TriangleMeshGeometries[geometry.index], ray);
+						break;
+					case GeometryType::TriangleMeshInstance:
+						didHit = GeometryUtils::HitTest_TriangleMeshInstance(m_TriangleMeshInstances[geometry.index], ray);
+						break;
+					}
+
+					if (didHit)
+					{
+						return true;
+					}
+				}
+				return false;
+			});
 	}
 
 #pragma region Scene Helpers
@@ -117,6 +295,8 @@ namespace dae {
 		s.materialIndex = materialIndex;
 
 		m_SphereGeometries.emplace_back(s);
+		m_IsTopLevelDirty = true;
+		m_AreSpheresDirty = true;
 		return &m_SphereGeometries.back();
 	}
 
@@ -137,10 +317,24 @@ namespace dae {
 		m.cullMode = cullMode;
 		m.materialIndex = materialIndex;
 
-		m_TriangleMeshGeometries.emplace_back(m);
+		m_TriangleMeshGeometries.emplace_back(std::move(m));
+		m_IsTopLevelDirty = true;
 		return &m_TriangleMeshGeometries.back();
 	}
 
+	TriangleMeshInstance* Scene::AddTriangleMeshInstance(const std::shared_ptr<const MeshGeometry>& pGeometry, TriangleCullMode cullMode, unsigned char materialIndex)
+	{
+		TriangleMeshInstance instance{};
+		instance.pGeometry = pGeometry;
+		instance.cullMode = cullMode;
+		instance.materialIndex = materialIndex;
+		instance.UpdateTransforms();
+
+		m_TriangleMeshInstances.emplace_back(instance);
+		m_IsTopLevelDirty = true;
+		return &m_TriangleMeshInstances.back();
+	}
+
 	Light* Scene::AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color)
 	{
 		Light l;
@@ -370,6 +564,7 @@ namespace dae {
 			pMesh->positions,
 			pMesh->normals,
 			pMesh->indices);
+		pMesh->Optimize();
 
 		pMesh->UpdateTransforms();
 
@@ -428,24 +623,25 @@ namespace dae {
 		AddSphere(Vector3{ 1.75f, 3.f, 0.f }, .75f, matCT_GraySmoothPlastic);
 
 		//CW Winding Order!
+		//One triangle shared by all three instances, they only differ in transform and cull mode
 		const Triangle baseTriangle = { Vector3(-.75f, 1.5f, 0.f), Vector3(.75f, 0.f, 0.f), Vector3(-.75f, 0.f, 0.f) };
 
-		m_Meshes[0] = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-		m_Meshes[0]->AppendTriangle(baseTriangle, true);
+		const auto pTriangleGeometry = std::make_shared<MeshGeometry>();
+		pTriangleGeometry->positions = std::vector<Vector3>{ baseTriangle.v0, baseTriangle.v1, baseTriangle.v2 };
+		pTriangleGeometry->indices = std::vector<int>{ 0, 1, 2 };
+		pTriangleGeometry->normals = std::vector<Vector3>{ baseTriangle.normal };
+		pTriangleGeometry->BuildBVH();
+
+		m_Meshes[0] = AddTriangleMeshInstance(pTriangleGeometry, TriangleCullMode::BackFaceCulling, matLambert_White);
 		m_Meshes[0]->Translate({ -1.75f, 4.5f, 0.f });
-		m_Meshes[0]->UpdateAABB();
 		m_Meshes[0]->UpdateTransforms();
 
-		m_Meshes[1] = AddTriangleMesh(TriangleCullMode::FrontFaceCulling, matLambert_White);
-		m_Meshes[1]->AppendTriangle(baseTriangle, true);
+		m_Meshes[1] = AddTriangleMeshInstance(pTriangleGeometry, TriangleCullMode::FrontFaceCulling, matLambert_White);
 		m_Meshes[1]->Translate({ 0.f, 4.5f, 0.f });
-		m_Meshes[1]->UpdateAABB();
 		m_Meshes[1]->UpdateTransforms();
 
-		m_Meshes[2] = AddTriangleMesh(TriangleCullMode::NoCulling, matLambert_White);
-		m_Meshes[2]->AppendTriangle(baseTriangle, true);
+		m_Meshes[2] = AddTriangleMeshInstance(pTriangleGeometry, TriangleCullMode::NoCulling, matLambert_White);
 		m_Meshes[2]->Translate({ 1.75f, 4.5f, 0.f });
-		m_Meshes[2]->UpdateAABB();
 		m_Meshes[2]->UpdateTransforms();
 		
 		//Lights
@@ -486,16 +682,12 @@ namespace dae {
 	AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //RIGHT
 	AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //LEFT
 
-	m_BunnyMesh = AddTriangleMesh(TriangleCullMode::BackFaceCulling, matLambert_White);
-	Utils::ParseOBJ("Resources/lowpoly_bunny.obj",
-		m_BunnyMesh->positions,
-		m_BunnyMesh->normals,
-		m_BunnyMesh->indices);
+	const auto pBunnyGeometry = std::make_shared<MeshGeometry>();
+	MeshCache::LoadOBJ("Resources/lowpoly_bunny.obj", *pBunnyGeometry);
 
+	m_BunnyMesh = AddTriangleMeshInstance(pBunnyGeometry, TriangleCullMode::BackFaceCulling, matLambert_White);
 	m_BunnyMesh->Scale({ 2.f, 2.f, 2.f });
 	m_BunnyMesh->RotateY(180.f);
-
-	m_BunnyMesh->UpdateAABB();
 	m_BunnyMesh->UpdateTransforms();
 
 	//Lights
@@ -506,4 +698,129 @@ namespace dae {
 	}
 
 #pragma endregion
+
+#pragma region SCENE SCALING
+	Scene_Scaling::Scene_Scaling(uint32_t sphereCount, uint32_t triangleCount, uint32_t lightCount) :
+		m_SphereCount{ sphereCount },
+		m_TriangleCount{ triangleCount },
+		m_LightCount{ lightCount }
+	{
+	}
+
+	void Scene_Scaling::Initialize()
+	{
+		sceneName = "Scaling scene (" + std::to_string(m_SphereCount) + " spheres, " + std::to_string(m_TriangleCount)
+			+ " triangles, " + std::to_string(m_LightCount) + " lights)";
+		m_Camera.origin = { 0.f, 3.f, -9.f };
+		m_Camera.fovAngle = 45.f;
+
+		const auto matCT_GrayMediumMetal = AddMaterial(new Material_CookTorrence({ .972f, .960f, .915f }, 1.f, .6f));
+		const auto matCT_GrayMediumPlastic = AddMaterial(new Material_CookTorrence({ .75f, .75f, .75f }, .0f, .6f));
+		const auto matLambert_GrayBlue = AddMaterial(new Material_Lambert({ .49f, 0.57f, 0.57f }, 1.f));
+		const auto matLambert_White = AddMaterial(new Material_Lambert(colors::White, 1.f));
+
+		//Plane
+		AddPlane(Vector3{ 0.f, 0.f, 10.f }, Vector3{ 0.f, 0.f, -1.f }, matLambert_GrayBlue); //BACK
+		AddPlane(Vector3{ 0.f, 0.f, 0.f }, Vector3{ 0.f, 1.f, 0.f }, matLambert_GrayBlue); //BOTTOM
+		AddPlane(Vector3{ 0.f, 10.f, 0.f }, Vector3{ 0.f, -1.f, 0.f }, matLambert_GrayBlue); //TOP
+		AddPlane(Vector3{ 5.f, 0.f, 0.f }, Vector3{ -1.f, 0.f, 0.f }, matLambert_GrayBlue); //RIGHT
+		AddPlane(Vector3{ -5.f, 0.f, 0.f }, Vector3{ 1.f, 0.f, 0.f }, matLambert_GrayBlue); //LEFT
+
+		//Spheres on a cubic lattice in the box x [-4, 4], y [1, 7], z [-1, 7]
+		if (m_SphereCount > 0)
+		{
+			const uint32_t spheresPerSide{ static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<float>(m_SphereCount)) - 0.0001f)) };
+			const Vector3 boxMin{ -4.f, 1.f, -1.f };
+			const Vector3 spacing{ Vector3{ 8.f, 6.f, 8.f } / static_cast<float>(spheresPerSide) };
+			const float radius{ std::min({ spacing.x, spacing.y, spacing.z }) * .4f };
+
+			for (uint32_t i{ 0 }; i < m_SphereCount; ++i)
+			{
+				const uint32_t x{ i % spheresPerSide };
+				const uint32_t y{ (i / spheresPerSide) % spheresPerSide };
+				const uint32_t z{ i / (spheresPerSide * spheresPerSide) };
+				const Vector3 center{ boxMin.x + (x + .5f) * spacing.x, boxMin.y + (y + .5f) * spacing.y, boxMin.z + (z + .5f) * spacing.z };
+				AddSphere(center, radius, (i % 2) ? matCT_GrayMediumPlastic : matCT_GrayMediumMetal);
+			}
+		}
+
+		//Heightfield over the floor, x [-5, 5], z [-2, 10], two triangles per cell
+		if (m_TriangleCount > 0)
+		{
+			const uint32_t cellsPerSide{ std::max(static_cast<uint32_t>(std::ceil(std::sqrt(m_TriangleCount / 2.f))), 1u) };
+			const auto pHeightfield = std::make_shared<MeshGeometry>();
+
+			for (uint32_t z{ 0 }; z <= cellsPerSide; ++z)
+			{
+				for (uint32_t x{ 0 }; x <= cellsPerSide; ++x)
+				{
+					const float u{ static_cast<float>(x) / cellsPerSide };
+					const float v{ static_cast<float>(z) / cellsPerSide };
+					const float height{ .2f + .15f * sinf(u * PI_2 * 3.f) * cosf(v * PI_2 * 2.f) };
+					pHeightfield->positions.Edit().emplace_back(-5.f + u * 10.f, height, -2.f + v * 12.f);
+				}
+			}
+
+			//CW Winding Order, seen from above
+			const int verticesPerRow{ static_cast<int>(cellsPerSide) + 1 };
+			for (int z{ 0 }; z < static_cast<int>(cellsPerSide); ++z)
+			{
+				for (int x{ 0 }; x < static_cast<int>(cellsPerSide); ++x)
+				{
+					const int v00{ z * verticesPerRow + x };
+					const int v10{ v00 + 1 };
+					const int v01{ v00 + verticesPerRow };
+					const int v11{ v01 + 1 };
+					pHeightfield->indices.Edit().insert(pHeightfield->indices.Edit().end(), { v00, v01, v11, v00, v11, v10 });
+				}
+			}
+
+			pHeightfield->CalculateNormals();
+			pHeightfield->BuildBVH();
+			AddTriangleMeshInstance(pHeightfield, TriangleCullMode::BackFaceCulling, matLambert_White)->UpdateTransforms();
+		}
+
+		//Lights on a ring below the ceiling, together as bright as the reference scene's lights
+		for (uint32_t i{ 0 }; i < m_LightCount; ++i)
+		{
+			const float angle{ PI_2 * i / m_LightCount };
+			AddPointLight(Vector3{ 3.f * cosf(angle), 8.f, 3.f + 3.f * sinf(angle) }, 170.f / m_LightCount, ColorRGB{ 1.f, .8f, .6f });
+		}
+	}
+#pragma endregion
+
+#pragma region SCENE FACTORY
+	const std::vector<std::string>& GetSceneNames()
+	{
+		static const std::vector<std::string> sceneNames{ "W1", "W2", "W3_Test", "W3", "W4_Test", "W4_Reference", "W4_Bunny" };
+		return sceneNames;
+	}
+
+	std::unique_ptr<Scene> CreateScene(const std::string& name)
+	{
+		if (name == "W1") return std::make_unique<Scene_W1>();
+		if (name == "W2") return std::make_unique<Scene_W2>();
+		if (name == "W3_Test") return std::make_unique<Scene_W3_TestScene>();
+		if (name == "W3") return std::make_unique<Scene_W3>();
+		if (name == "W4_Test") return std::make_unique<Scene_W4_TestScene>();
+		if (name == "W4_Reference") return std::make_unique<Scene_W4_ReferenceScene>();
+		if (name == "W4_Bunny") return std::make_unique<Scene_W4_Bunny>();
+		if (name.ends_with(".scene")) return std::make_unique<Scene_File>(name);
+		if (name.ends_with(".rtscene")) return std::make_unique<Scene_Snapshot>(name);
+
+		//Scaling scenes, Spheres_<N>, Triangles_<N> or Lights_<N>, the other counts stay at their defaults
+		const size_t separator{ name.find('_') };
+		if (separator == std::string::npos || separator + 1 == name.size()
+			|| name.find_first_not_of("0123456789", separator + 1) != std::string::npos || name.size() - separator > 10)
+			return nullptr;
+
+		const std::string prefix{ name.substr(0, separator) };
+		const uint32_t count{ static_cast<uint32_t>(std::stoul(name.substr(separator + 1))) };
+		const uint32_t defaultSphereCount{ 8 }, defaultTriangleCount{ 128 }, defaultLightCount{ 3 };
+		if (prefix == "Spheres") return std::make_unique<Scene_Scaling>(count, defaultTriangleCount, defaultLightCount);
+		if (prefix == "Triangles") return std::make_unique<Scene_Scaling>(defaultSphereCount, count, defaultLightCount);
+		if (prefix == "Lights") return std::make_unique<Scene_Scaling>(defaultSphereCount, defaultTriangleCount, count);
+		return nullptr;
+	}
+#pragma endregion
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -30,12 +31,25 @@ namespace dae
 		virtual void Initialize() = 0;
 		virtual void Update(dae::Timer* pTimer)
 		{
-			m_Camera.Update(pTimer);
+			m_Camera.Update(m_CameraInput, pTimer);
 		}
 
 		Camera& GetCamera() { return m_Camera; }
+		//Input the camera follows on the next Update, set by the frontend every frame
+		void SetCameraInput(const CameraInput& input) { m_CameraInput = input; }
+		//Rebuilds the top level BVH when geometry was added, refits it when meshes moved since the last call
+		void UpdateAccelerationStructure();
 		void GetClosestHit(const Ray& ray, HitRecord& closestHit) const;
-		bool DoesHit(const Ray& ray) const;
+		//Closest hit for every ray of a coherent packet, closestHits needs room for packet.size records
+		void GetClosestHits(RayPacket& packet, HitRecord* closestHits) const;
+		//Any-hit query for shadow rays: stops at the first hit on every level and never builds a HitRecord
+		bool IsOccluded(const Ray& ray) const;
+		/**
+		 * \brief Writes the scene as it is now to a binary snapshot, a Scene_Snapshot loads it without building anything
+		 * Holds the camera, materials, primitives, lights and every acceleration structure, indices only so it loads at any address
+		 * \return false when the file could not be written
+		 */
+		bool SaveSnapshot(const std::string& filePath);
 
 		const std::vector<Plane>& GetPlaneGeometries() const { return m_PlaneGeometries; }
 		const std::vector<Sphere>& GetSphereGeometries() const { return m_SphereGeometries; }
@@ -48,21 +62,57 @@ namespace dae
 		std::vector<Plane> m_PlaneGeometries{};
 		std::vector<Sphere> m_SphereGeometries{};
 		std::vector<TriangleMesh> m_TriangleMeshGeometries{};
+		std::vector<TriangleMeshInstance> m_TriangleMeshInstances{};
 		std::vector<Light> m_Lights{};
 		std::vector<Material*> m_Materials{};
 
 		//Temp (Individual Triangle Testing)
 		//std::vector<Triangle> m_Triangles{};
 
+		//Top level acceleration structure over all bounded geometry (the sphere set, meshes)
+		//Planes are unbounded, they stay in m_PlaneGeometries and are tested separately
+		enum class GeometryType : unsigned char
+		{
+			Spheres,
+			TriangleMesh,
+			TriangleMeshInstance
+		};
+
+		struct BoundedGeometry
+		{
+			GeometryType type{};
+			uint32_t index{};
+			uint32_t transformRevision{};
+		};
+
+		std::vector<BoundedGeometry> m_BoundedGeometries{};
+		std::vector<AABB> m_BoundedGeometryBounds{};
+		BVH m_TopLevelBVH{};
+		bool m_IsTopLevelDirty{ true };
+
+		//All spheres form a single top level entry with their own BVH, its leaves are SoA blocks for the SIMD kernel
+		BVH m_SphereBVH{};
+		SphereSoA m_Spheres{};
+		//Set when m_SphereGeometries changed, a top level rebuild for other geometry then keeps the sphere BVH
+		bool m_AreSpheresDirty{ true };
+
 		Camera m_Camera{};
+		CameraInput m_CameraInput{};
 
 		Sphere* AddSphere(const Vector3& origin, float radius, unsigned char materialIndex = 0);
 		Plane* AddPlane(const Vector3& origin, const Vector3& normal, unsigned char materialIndex = 0);
 		TriangleMesh* AddTriangleMesh(TriangleCullMode cullMode, unsigned char materialIndex = 0);
+		TriangleMeshInstance* AddTriangleMeshInstance(const std::shared_ptr<const MeshGeometry>& pGeometry, TriangleCullMode cullMode, unsigned char materialIndex = 0);
 
 		Light* AddPointLight(const Vector3& origin, float intensity, const ColorRGB& color);
 		Light* AddDirectionalLight(const Vector3& direction, float intensity, const ColorRGB& color);
 		unsigned char AddMaterial(Material* pMaterial);
+		//Replaces the scene with a snapshot, false for a missing, damaged or incompatible snapshot which leaves the scene unchanged
+		bool LoadSnapshot(const std::string& filePath);
+
+	private:
+		void BuildTopLevel();
+		AABB GetBounds(const BoundedGeometry& geometry) const;
 	};
 
 	//+++++++++++++++++++++++++++++++++++++++++
@@ -165,7 +215,7 @@ namespace dae
 		void Update(Timer* pTimer) override;
 
 	private:
-		TriangleMesh* m_Meshes[3]{};
+		TriangleMeshInstance* m_Meshes[3]{};
 	};
 
 	//WEEK 4 Bunny_Scene
@@ -183,6 +233,39 @@ namespace dae
 		void Initialize() override;
 
 	private:
-		TriangleMesh* m_BunnyMesh;
+		TriangleMeshInstance* m_BunnyMesh{ nullptr };
 	};
+
+	//Procedural benchmark scene, the reference room with a configurable amount of spheres, triangles and lights
+	//Scaling one count while keeping the others fixed shows how each part of the tracer scales
+	class Scene_Scaling final : public Scene
+	{
+	public:
+		/**
+		 * \param sphereCount spheres on a lattice filling the room
+		 * \param triangleCount about this many triangles in a heightfield covering the floor
+		 * \param lightCount point lights on a ring below the ceiling, sharing the same total intensity
+		 */
+		Scene_Scaling(uint32_t sphereCount, uint32_t triangleCount, uint32_t lightCount);
+		~Scene_Scaling() override = default;
+
+		Scene_Scaling(const Scene_Scaling&) = delete;
+		Scene_Scaling(Scene_Scaling&&) noexcept = delete;
+		Scene_Scaling& operator=(const Scene_Scaling&) = delete;
+		Scene_Scaling& operator=(Scene_Scaling&&) noexcept = delete;
+
+		void Initialize() override;
+
+	private:
+		uint32_t m_SphereCount{};
+		uint32_t m_TriangleCount{};
+		uint32_t m_LightCount{};
+	};
+
+	//Names accepted by CreateScene, in week order
+	//CreateScene also accepts Spheres_<N>, Triangles_<N> and Lights_<N>, which scale one count of a Scene_Scaling,
+	//the path of a .scene file, which is loaded by a Scene_File, and the path of a .rtscene snapshot, loaded by a Scene_Snapshot
+	const std::vector<std::string>& GetSceneNames();
+	//Creates the scene registered under name, not initialized yet, nullptr when the name is unknown
+	std::unique_ptr<Scene> CreateScene(const std::string& name);
 }
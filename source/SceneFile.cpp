@@ -0,0 +1,487 @@
+#include "SceneFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "MeshCache.h"
+#include "Trace.h"
+
+using namespace dae;
+
+namespace
+{
+	bool ReadVector(std::istream& statement, Vector3& vector)
+	{
+		return static_cast<bool>(statement >> vector.x >> vector.y >> vector.z);
+	}
+
+	bool ReadColor(std::istream& statement, ColorRGB& color)
+	{
+		return static_cast<bool>(statement >> color.r >> color.g >> color.b);
+	}
+
+	//False for an unknown type or missing parameters
+	bool ReadMaterial(std::istream& statement, MaterialDescription& material)
+	{
+		std::string type{};
+		if (!(statement >> type) || !ReadColor(statement, material.color))
+			return false;
+
+		float* pParameters{ material.parameters };
+		if (type == "solid")
+		{
+			material.type = MaterialType::SolidColor;
+			return true;
+		}
+		if (type == "lambert")
+		{
+			material.type = MaterialType::Lambert;
+			return static_cast<bool>(statement >> pParameters[0]);
+		}
+		if (type == "lambertphong")
+		{
+			material.type = MaterialType::LambertPhong;
+			return static_cast<bool>(statement >> pParameters[0] >> pParameters[1] >> pParameters[2]);
+		}
+		if (type == "cooktorrence")
+		{
+			material.type = MaterialType::CookTorrence;
+			return static_cast<bool>(statement >> pParameters[0] >> pParameters[1]);
+		}
+		return false;
+	}
+
+	//Reads the optional cull, translate, rotate and scale keywords after the material of a mesh statement
+	bool ReadPlacement(std::istream& statement, TriangleCullMode& cullMode, Vector3& translation, float& yaw, Vector3& scale)
+	{
+		std::string option{};
+		while (statement >> option)
+		{
+			bool isOptionValid{};
+			if (option == "cull")
+			{
+				std::string cullName{};
+				statement >> cullName;
+				isOptionValid = true;
+				if (cullName == "back")
+					cullMode = TriangleCullMode::BackFaceCulling;
+				else if (cullName == "front")
+					cullMode = TriangleCullMode::FrontFaceCulling;
+				else if (cullName == "none")
+					cullMode = TriangleCullMode::NoCulling;
+				else
+					isOptionValid = false;
+			}
+			else if (option == "translate")
+				isOptionValid = ReadVector(statement, translation);
+			else if (option == "rotate")
+				isOptionValid = static_cast<bool>(statement >> yaw);
+			else if (option == "scale")
+				isOptionValid = ReadVector(statement, scale);
+
+			if (!isOptionValid)
+				return false;
+		}
+		return true;
+	}
+
+	//The tokens of a statement joined by single spaces, so a reload does not take reformatting for a change
+	std::string NormalizeStatement(const std::string& line)
+	{
+		std::istringstream tokens{ line };
+		std::string statement{}, token{};
+		while (tokens >> token)
+		{
+			if (!statement.empty())
+				statement += ' ';
+			statement += token;
+		}
+		return statement;
+	}
+}
+
+Scene_File::Scene_File(const std::string& filePath) :
+	m_FilePath{ filePath }
+{
+}
+
+void Scene_File::Initialize()
+{
+	sceneName = m_FilePath;
+	m_FileWatcher.Watch(m_FilePath);
+
+	Description description{};
+	if (Parse(description) == ParseResult::Unreadable)
+		return;
+
+	//The first frame needs every mesh
+	for (auto& [path, load] : m_MeshLoads)
+	{
+		load.wait();
+	}
+	ReceiveMeshes();
+	Apply(std::move(description));
+}
+
+void Scene_File::Update(Timer* pTimer)
+{
+	Scene::Update(pTimer);
+
+	for (const std::string& filePath : m_FileWatcher.PollChanges())
+	{
+		if (filePath == m_FilePath)
+		{
+			//A newer save replaces a description that is still waiting for its meshes
+			//A save with errors is most likely still being edited, the scene and a waiting description stay until the file parses again
+			std::unique_ptr<Description> pDescription{ std::make_unique<Description>() };
+			const ParseResult result{ Parse(*pDescription) };
+			if (result == ParseResult::Valid)
+				m_pPendingDescription = std::move(pDescription);
+			else if (result == ParseResult::HasErrors)
+				std::cerr << m_FilePath << ": kept the current scene, fix the statements above to apply the changes\n";
+		}
+		else if (m_MeshLoads.contains(filePath))
+			m_OutdatedMeshLoads.insert(filePath);
+		else
+			LoadMesh(filePath);
+	}
+
+	ReceiveMeshes();
+
+	if (m_pPendingDescription)
+	{
+		const bool isLoading{ std::any_of(m_pPendingDescription->meshes.begin(), m_pPendingDescription->meshes.end(),
+			[this](const MeshPlacement& placement) { return m_MeshLoads.contains(placement.path); }) };
+		if (!isLoading)
+		{
+			Apply(std::move(*m_pPendingDescription));
+			m_pPendingDescription.reset();
+			std::cout << m_FilePath << ": applied the changes\n";
+		}
+	}
+}
+
+Scene_File::ParseResult Scene_File::Parse(Description& description)
+{
+	std::ifstream file{ m_FilePath };
+	if (!file)
+	{
+		std::cerr << m_FilePath << ": could not open the scene file\n";
+		return ParseResult::Unreadable;
+	}
+
+	const std::filesystem::path directory{ std::filesystem::path{ m_FilePath }.parent_path() };
+	std::unordered_map<std::string, unsigned char> materials{};
+
+	ParseResult result{ ParseResult::Valid };
+	std::string line{};
+	for (int lineNumber{ 1 }; std::getline(file, line); ++lineNumber)
+	{
+		const size_t commentStart{ line.find('#') };
+		if (commentStart != std::string::npos)
+			line.erase(commentStart);
+
+		std::istringstream statement{ line };
+		std::string keyword{};
+		if (!(statement >> keyword))
+			continue;
+
+		const auto readMaterialIndex = [&statement, &materials](unsigned char& materialIndex)
+			{
+				std::string name{};
+				statement >> name;
+				const auto material{ materials.find(name) };
+				if (material == materials.end())
+					return false;
+
+				materialIndex = material->second;
+				return true;
+			};
+
+		bool isValid{};
+		if (keyword == "camera")
+		{
+			Vector3 origin{}, forward{ Vector3::UnitZ };
+			float fovAngle{};
+			isValid = ReadVector(statement, origin) && statement >> fovAngle;
+			std::string option{};
+			if (isValid && statement >> option)
+				isValid = option == "forward" && ReadVector(statement, forward) && forward.Normalize() > 0.f;
+
+			if (isValid)
+			{
+				description.cameraStatement = NormalizeStatement(line);
+				description.cameraOrigin = origin;
+				description.cameraFovAngle = fovAngle;
+				description.cameraForward = forward;
+			}
+		}
+		else if (keyword == "material")
+		{
+			NamedMaterial material{};
+			material.lineNumber = lineNumber;
+			//Material indices are stored in an unsigned char and the scene keeps index 0 for its default material
+			isValid = statement >> material.name && ReadMaterial(statement, material.description) && description.materials.size() < UINT8_MAX;
+			if (isValid)
+			{
+				material.statement = NormalizeStatement(line);
+				materials[material.name] = static_cast<unsigned char>(description.materials.size());
+				description.materials.push_back(std::move(material));
+			}
+		}
+		else if (keyword == "plane")
+		{
+			Plane plane{};
+			isValid = ReadVector(statement, plane.origin) && ReadVector(statement, plane.normal) && readMaterialIndex(plane.materialIndex) && plane.normal.Normalize() > 0.f;
+			if (isValid)
+			{
+				description.planes.push_back(plane);
+				description.planeStatements += NormalizeStatement(line) + '\n';
+			}
+		}
+		else if (keyword == "sphere")
+		{
+			Sphere sphere{};
+			isValid = ReadVector(statement, sphere.origin) && statement >> sphere.radius && readMaterialIndex(sphere.materialIndex);
+			if (isValid)
+			{
+				description.spheres.push_back(sphere);
+				description.sphereStatements += NormalizeStatement(line) + '\n';
+			}
+		}
+		else if (keyword == "mesh")
+		{
+			MeshPlacement placement{};
+			placement.lineNumber = lineNumber;
+			std::string relativePath{};
+			isValid = statement >> relativePath && readMaterialIndex(placement.materialIndex)
+				&& ReadPlacement(statement, placement.cullMode, placement.translation, placement.yaw, placement.scale);
+			if (isValid)
+			{
+				placement.path = (directory / relativePath).string();
+				placement.statement = NormalizeStatement(line);
+				if (!m_Geometries.contains(placement.path) && !m_MeshLoads.contains(placement.path))
+					LoadMesh(placement.path);
+				description.meshes.push_back(std::move(placement));
+			}
+		}
+		else if (keyword == "light")
+		{
+			std::string type{};
+			Vector3 vector{};
+			Light light{};
+			isValid = statement >> type && ReadVector(statement, vector) && statement >> light.intensity && ReadColor(statement, light.color);
+			if (isValid && type == "point")
+			{
+				light.origin = vector;
+				light.type = LightType::Point;
+			}
+			else if (isValid && type == "directional" && vector.Normalize() > 0.f)
+			{
+				light.direction = vector;
+				light.type = LightType::Directional;
+			}
+			else
+				isValid = false;
+
+			if (isValid)
+			{
+				description.lights.push_back(light);
+				description.lightStatements += NormalizeStatement(line) + '\n';
+			}
+		}
+
+		if (!isValid)
+		{
+			std::cerr << m_FilePath << ':' << lineNumber << ": could not parse \"" << line << "\"\n";
+			result = ParseResult::HasErrors;
+		}
+	}
+	return result;
+}
+
+void Scene_File::LoadMesh(const std::string& path)
+{
+	m_FileWatcher.Watch(path);
+	m_MeshLoads[path] = std::async(std::launch::async, [path]()
+		{
+			const TraceScope loadScope{ "Scene_File::LoadMesh" };
+			std::shared_ptr<MeshGeometry> pGeometry{ std::make_shared<MeshGeometry>() };
+			return MeshCache::LoadOBJ(path, *pGeometry) ? std::shared_ptr<const MeshGeometry>{ pGeometry } : nullptr;
+		});
+}
+
+void Scene_File::ReceiveMeshes()
+{
+	std::vector<std::string> outdatedPaths{};
+	for (auto load{ m_MeshLoads.begin() }; load != m_MeshLoads.end();)
+	{
+		if (load->second.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+		{
+			++load;
+			continue;
+		}
+
+		const std::string path{ load->first };
+		const std::shared_ptr<const MeshGeometry> pGeometry{ load->second.get() };
+		load = m_MeshLoads.erase(load);
+		if (m_OutdatedMeshLoads.erase(path))
+		{
+			outdatedPaths.push_back(path);
+			continue;
+		}
+
+		const auto loadedGeometry{ m_Geometries.find(path) };
+		if (!pGeometry)
+		{
+			//A failed first load is reported by the mesh statements that use it
+			if (loadedGeometry != m_Geometries.end())
+				std::cerr << path << ": could not reload the mesh, the previous geometry stays\n";
+			continue;
+		}
+
+		if (loadedGeometry != m_Geometries.end())
+		{
+			//Only the instances of this OBJ change, their new bounds refit the top level
+			loadedGeometry->second = pGeometry;
+			for (size_t i{ 0 }; i < m_PlacedMeshes.size(); ++i)
+			{
+				if (m_PlacedMeshes[i].path != path)
+					continue;
+
+				m_TriangleMeshInstances[i].pGeometry = pGeometry;
+				m_TriangleMeshInstances[i].UpdateTransforms();
+			}
+			std::cout << path << ": reloaded the mesh\n";
+			continue;
+		}
+
+		//A mesh that failed to load before gets its instances by applying the current description again
+		m_Geometries.emplace(path, pGeometry);
+		const bool isUsed{ std::any_of(m_Description.meshes.begin(), m_Description.meshes.end(),
+			[&path](const MeshPlacement& placement) { return placement.path == path; }) };
+		if (isUsed && !m_pPendingDescription)
+			m_pPendingDescription = std::make_unique<Description>(m_Description);
+	}
+
+	for (const std::string& path : outdatedPaths)
+	{
+		LoadMesh(path);
+	}
+}
+
+void Scene_File::Apply(Description&& description)
+{
+	const TraceScope applyScope{ "Scene_File::Apply" };
+
+	std::vector<unsigned char> materialIndices(description.materials.size());
+	for (size_t i{ 0 }; i < description.materials.size(); ++i)
+	{
+		const NamedMaterial& material = description.materials[i];
+		auto slot{ m_MaterialSlots.find(material.name) };
+		if (slot == m_MaterialSlots.end())
+		{
+			//Names removed from the file keep their index, so a long session can run out of them
+			if (m_Materials.size() > UINT8_MAX)
+			{
+				std::cerr << m_FilePath << ':' << material.lineNumber << ": no material index left for " << material.name << '\n';
+				continue;
+			}
+			slot = m_MaterialSlots.emplace(material.name, MaterialSlot{ AddMaterial(CreateMaterial(material.description)), material.statement }).first;
+		}
+		else if (slot->second.statement != material.statement)
+		{
+			delete m_Materials[slot->second.index];
+			m_Materials[slot->second.index] = CreateMaterial(material.description);
+			slot->second.statement = material.statement;
+		}
+		materialIndices[i] = slot->second.index;
+	}
+
+	//The camera only jumps when its statement changed, a reload keeps where the user moved it
+	if (description.cameraStatement != m_Description.cameraStatement)
+	{
+		m_Camera.origin = description.cameraOrigin;
+		m_Camera.fovAngle = description.cameraFovAngle;
+		m_Camera.forward = description.cameraForward;
+		m_Camera.totalPitch = 0.f;
+		m_Camera.totalYaw = 0.f;
+	}
+
+	if (description.planeStatements != m_Description.planeStatements)
+	{
+		m_PlaneGeometries = description.planes;
+		for (Plane& plane : m_PlaneGeometries)
+		{
+			plane.materialIndex = materialIndices[plane.materialIndex];
+		}
+	}
+
+	if (description.sphereStatements != m_Description.sphereStatements)
+	{
+		m_SphereGeometries = description.spheres;
+		for (Sphere& sphere : m_SphereGeometries)
+		{
+			sphere.materialIndex = materialIndices[sphere.materialIndex];
+		}
+		m_IsTopLevelDirty = true;
+		m_AreSpheresDirty = true;
+	}
+
+	if (description.lightStatements != m_Description.lightStatements)
+		m_Lights = description.lights;
+
+	std::vector<MeshPlacement> placements{};
+	placements.reserve(description.meshes.size());
+	for (const MeshPlacement& placement : description.meshes)
+	{
+		if (!m_Geometries.contains(placement.path))
+		{
+			std::cerr << m_FilePath << ':' << placement.lineNumber << ": could not load mesh " << placement.path << '\n';
+			continue;
+		}
+
+		placements.push_back(placement);
+		placements.back().materialIndex = materialIndices[placement.materialIndex];
+	}
+
+	const auto placeInstance = [](TriangleMeshInstance& instance, const MeshPlacement& placement)
+		{
+			instance.materialIndex = placement.materialIndex;
+			instance.cullMode = placement.cullMode;
+			instance.Translate(placement.translation);
+			instance.RotateY(placement.yaw);
+			instance.Scale(placement.scale);
+			instance.UpdateTransforms();
+		};
+
+	const bool isSameLayout{ std::equal(placements.begin(), placements.end(), m_PlacedMeshes.begin(), m_PlacedMeshes.end(),
+		[](const MeshPlacement& placement, const MeshPlacement& placedMesh) { return placement.path == placedMesh.path; }) };
+	if (isSameLayout)
+	{
+		//Changed instances only refit their top level entry
+		for (size_t i{ 0 }; i < placements.size(); ++i)
+		{
+			if (placements[i].statement != m_PlacedMeshes[i].statement)
+				placeInstance(m_TriangleMeshInstances[i], placements[i]);
+		}
+	}
+	else
+	{
+		//Adding or removing an instance rebuilds the top level, the geometry BVHs are shared and stay
+		m_TriangleMeshInstances.clear();
+		m_TriangleMeshInstances.reserve(placements.size());
+		for (const MeshPlacement& placement : placements)
+		{
+			placeInstance(*AddTriangleMeshInstance(m_Geometries[placement.path], placement.cullMode, placement.materialIndex), placement);
+		}
+		m_IsTopLevelDirty = true;
+	}
+
+	m_PlacedMeshes = std::move(placements);
+	m_Description = std::move(description);
+}
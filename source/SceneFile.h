@@ -0,0 +1,126 @@
+#pragma once
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "FileWatcher.h"
+#include "Material.h"
+#include "Scene.h"
+
+namespace dae
+{
+	//Scene described by a text file, so scenes can change without a rebuild
+	//One statement per line, # starts a comment, paths are relative to the scene file:
+	//  camera <x y z> <fov> [forward <x y z>]
+	//  material <name> solid <r g b>
+	//  material <name> lambert <r g b> <reflectance>
+	//  material <name> lambertphong <r g b> <kd> <ks> <exponent>
+	//  material <name> cooktorrence <r g b> <metalness> <roughness>
+	//  plane <x y z> <normal x y z> <material>
+	//  sphere <x y z> <radius> <material>
+	//  mesh <obj path> <material> [cull back|front|none] [translate <x y z>] [rotate <yaw>] [scale <x y z>]
+	//  light point <x y z> <intensity> <r g b>
+	//  light directional <direction x y z> <intensity> <r g b>
+	//Materials have to be declared before they are used, every mesh statement places an instance of the shared OBJ geometry
+	//The scene file and its OBJ files are watched while the scene lives, a saved change is applied to the running scene:
+	//only the changed materials, camera, lights, planes, spheres and instances are replaced and a changed OBJ only swaps its geometry
+	class Scene_File final : public Scene
+	{
+	public:
+		explicit Scene_File(const std::string& filePath);
+		~Scene_File() override = default;
+
+		Scene_File(const Scene_File&) = delete;
+		Scene_File(Scene_File&&) noexcept = delete;
+		Scene_File& operator=(const Scene_File&) = delete;
+		Scene_File& operator=(Scene_File&&) noexcept = delete;
+
+		//Every OBJ starts loading on its own thread at its first mesh statement, while the rest of the file is parsed
+		//Statements that can not be parsed and meshes that fail to load are reported on std::cerr and skipped
+		void Initialize() override;
+		//Applies saved changes once the OBJ files they need are loaded, meshes keep loading on their own threads meanwhile
+		//A save with a statement that can not be parsed is reported and leaves the scene as it is, a half typed line removes nothing
+		void Update(Timer* pTimer) override;
+
+	private:
+		struct NamedMaterial
+		{
+			std::string name{};
+			MaterialDescription description{};
+			std::string statement{};
+			int lineNumber{};
+		};
+
+		struct MeshPlacement
+		{
+			std::string path{};
+			//Index into the materials of the description until it is applied
+			unsigned char materialIndex{};
+			TriangleCullMode cullMode{ TriangleCullMode::BackFaceCulling };
+			Vector3 translation{};
+			float yaw{};
+			Vector3 scale{ 1.f, 1.f, 1.f };
+			int lineNumber{};
+			std::string statement{};
+		};
+
+		//Everything a scene file declares, material indices point into materials
+		//The statements are kept whitespace normalized, a reload compares them to find what changed
+		struct Description
+		{
+			std::string cameraStatement{};
+			Vector3 cameraOrigin{};
+			float cameraFovAngle{};
+			Vector3 cameraForward{ Vector3::UnitZ };
+
+			std::vector<NamedMaterial> materials{};
+			std::vector<Plane> planes{};
+			std::vector<Sphere> spheres{};
+			std::vector<Light> lights{};
+			std::vector<MeshPlacement> meshes{};
+			std::string planeStatements{};
+			std::string sphereStatements{};
+			std::string lightStatements{};
+		};
+
+		struct MaterialSlot
+		{
+			unsigned char index{};
+			std::string statement{};
+		};
+
+		std::string m_FilePath{};
+		FileWatcher m_FileWatcher{};
+
+		//The description the scene currently shows and the reloaded one that waits for its meshes
+		Description m_Description{};
+		std::unique_ptr<Description> m_pPendingDescription{};
+		//A material name keeps its scene index across reloads, a changed material is replaced at that index
+		std::unordered_map<std::string, MaterialSlot> m_MaterialSlots{};
+		//Placement of every instance in m_TriangleMeshInstances
+		std::vector<MeshPlacement> m_PlacedMeshes{};
+
+		std::unordered_map<std::string, std::shared_ptr<const MeshGeometry>> m_Geometries{};
+		std::unordered_map<std::string, std::future<std::shared_ptr<const MeshGeometry>>> m_MeshLoads{};
+		//OBJ files saved again while they were loading, they load once more when the running load finishes
+		std::unordered_set<std::string> m_OutdatedMeshLoads{};
+
+		enum class ParseResult
+		{
+			Unreadable,
+			//Statements that could not be parsed were reported and skipped
+			HasErrors,
+			Valid
+		};
+
+		//Starts loading the OBJ files of new mesh paths while parsing
+		ParseResult Parse(Description& description);
+		void LoadMesh(const std::string& path);
+		//Takes the geometry of finished loads, swapping it into the instances of a reloaded OBJ
+		void ReceiveMeshes();
+		void Apply(Description&& description);
+	};
+}
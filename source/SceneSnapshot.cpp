@@ -0,0 +1,571 @@
+#include "SceneSnapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <type_traits>
+
+#include "MappedFile.h"
+#include "Material.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr char g_Magic[8]{ 'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0' };
+	//Bumped whenever the stored data changes meaning
+	constexpr uint32_t g_Version{ 1 };
+	//Arrays start on a cache line, the alignment BVH4Node has in memory
+	constexpr uint64_t g_ArrayAlignment{ 64 };
+
+	//Layout of everything stored as raw bytes, a snapshot from a build with other sizes or SIMD widths is refused
+	struct SnapshotHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t planeSize;
+		uint32_t sphereSize;
+		uint32_t lightSize;
+		uint32_t nodeSize;
+		uint32_t wideNodeSize;
+		uint32_t triangleBlockSize;
+		uint32_t sphereBlockSize;
+	};
+
+	SnapshotHeader CreateHeader()
+	{
+		SnapshotHeader header{};
+		std::memcpy(header.magic, g_Magic, sizeof(g_Magic));
+		header.version = g_Version;
+		header.planeSize = sizeof(Plane);
+		header.sphereSize = sizeof(Sphere);
+		header.lightSize = sizeof(Light);
+		header.nodeSize = sizeof(BVHNode);
+		header.wideNodeSize = sizeof(BVH4Node);
+		header.triangleBlockSize = TriangleSoA::BlockSize;
+		header.sphereBlockSize = SphereSoA::BlockSize;
+		return header;
+	}
+
+	//Matrix has a user defined copy constructor, so its rows are stored instead
+	struct MatrixRecord
+	{
+		Vector4 rows[4];
+	};
+
+	MatrixRecord ToRecord(const Matrix& matrix)
+	{
+		return MatrixRecord{ { matrix[0], matrix[1], matrix[2], matrix[3] } };
+	}
+
+	Matrix FromRecord(const MatrixRecord& record)
+	{
+		return Matrix{ record.rows[0], record.rows[1], record.rows[2], record.rows[3] };
+	}
+
+	//The camera to world matrix is left out, the renderer calculates it every frame
+	struct CameraRecord
+	{
+		Vector3 origin;
+		float fovAngle;
+		Vector3 forward;
+		Vector3 up;
+		Vector3 right;
+		float totalPitch;
+		float totalYaw;
+	};
+
+	struct TriangleMeshRecord
+	{
+		unsigned char materialIndex;
+		TriangleCullMode cullMode;
+		uint32_t transformRevision;
+		MatrixRecord rotationTransform;
+		MatrixRecord translationTransform;
+		MatrixRecord scaleTransform;
+		Vector3 minAABB;
+		Vector3 maxAABB;
+		Vector3 transformedMinAABB;
+		Vector3 transformedMaxAABB;
+	};
+
+	struct InstanceRecord
+	{
+		//Index into the snapshot's geometry list, instances sharing geometry share it again after loading
+		uint32_t geometryIndex;
+		unsigned char materialIndex;
+		TriangleCullMode cullMode;
+		uint32_t transformRevision;
+		MatrixRecord rotationTransform;
+		MatrixRecord translationTransform;
+		MatrixRecord scaleTransform;
+		MatrixRecord worldTransform;
+		MatrixRecord inverseWorldTransform;
+		AABB worldBounds;
+	};
+
+	uint64_t AlignUp(uint64_t value)
+	{
+		return (value + g_ArrayAlignment - 1) & ~(g_ArrayAlignment - 1);
+	}
+
+	class SnapshotWriter final
+	{
+	public:
+		explicit SnapshotWriter(const std::string& filePath) :
+			m_File{ filePath, std::ios::binary }
+		{
+		}
+
+		template<typename T>
+		void Write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			m_File.write(reinterpret_cast<const char*>(&value), sizeof(T));
+			m_Size += sizeof(T);
+		}
+
+		//Takes vectors, spans and SharedArrays alike
+		template<typename Array>
+		void WriteArray(const Array& elements)
+		{
+			using T = std::remove_cvref_t<decltype(*elements.data())>;
+			static_assert(std::is_trivially_copyable_v<T>);
+			Write(uint64_t{ elements.size() });
+
+			constexpr char padding[g_ArrayAlignment]{};
+			const uint64_t paddingSize{ AlignUp(m_Size) - m_Size };
+			m_File.write(padding, paddingSize);
+			m_File.write(reinterpret_cast<const char*>(elements.data()), elements.size() * sizeof(T));
+			m_Size += paddingSize + elements.size() * sizeof(T);
+		}
+
+		void WriteBVH(const BVH& bvh)
+		{
+			WriteArray(bvh.GetNodes());
+			WriteArray(bvh.GetWideNodes());
+			WriteArray(bvh.GetPrimitiveIndices());
+		}
+
+		//Flushes the file, false when anything could not be written
+		bool Close()
+		{
+			m_File.close();
+			return !m_File.fail();
+		}
+
+	private:
+		std::ofstream m_File;
+		uint64_t m_Size{};
+	};
+
+	//Reads what SnapshotWriter wrote, a read past the end fails this and every later read
+	class SnapshotReader final
+	{
+	public:
+		explicit SnapshotReader(std::shared_ptr<const MappedFile> pFile) :
+			m_pFile{ std::move(pFile) },
+			m_pData{ m_pFile->GetData() },
+			m_Size{ m_pFile->GetSize() }
+		{
+		}
+
+		template<typename T>
+		bool Read(T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>);
+			if (!m_IsGood || m_Size - m_Position < sizeof(T))
+				return m_IsGood = false;
+
+			std::memcpy(&value, m_pData + m_Position, sizeof(T));
+			m_Position += sizeof(T);
+			return true;
+		}
+
+		//Copies the elements, for small arrays and the ones every frame rewrites
+		template<typename T>
+		bool ReadArray(std::vector<T>& elements)
+		{
+			const std::span<const T> mappedElements{ ReadMappedArray<T>() };
+			elements.assign(mappedElements.begin(), mappedElements.end());
+			return m_IsGood;
+		}
+
+		//Borrows the elements from the mapping, which stays open as long as any array borrows from it
+		template<typename T>
+		bool ReadArray(SharedArray<T>& elements)
+		{
+			elements = SharedArray<T>{ ReadMappedArray<T>(), m_pFile };
+			return m_IsGood;
+		}
+
+		bool ReadBVH(BVH& bvh)
+		{
+			SharedArray<BVHNode> nodes{};
+			SharedArray<BVH4Node> wideNodes{};
+			SharedArray<uint32_t> primitiveIndices{};
+			if (!ReadArray(nodes) || !ReadArray(wideNodes) || !ReadArray(primitiveIndices))
+				return false;
+
+			return m_IsGood = bvh.Load(std::move(nodes), std::move(wideNodes), std::move(primitiveIndices));
+		}
+
+		bool IsGood() const { return m_IsGood; }
+
+	private:
+		//Arrays start on g_ArrayAlignment in a page aligned mapping, so the elements are aligned for T
+		template<typename T>
+		std::span<const T> ReadMappedArray()
+		{
+			static_assert(std::is_trivially_copyable_v<T> && alignof(T) <= g_ArrayAlignment);
+			uint64_t count{};
+			if (!Read(count))
+				return {};
+
+			m_Position = AlignUp(m_Position);
+			if (m_Position > m_Size || count > (m_Size - m_Position) / sizeof(T))
+			{
+				m_IsGood = false;
+				return {};
+			}
+
+			const std::span<const T> elements{ reinterpret_cast<const T*>(m_pData + m_Position), count };
+			m_Position += count * sizeof(T);
+			return elements;
+		}
+
+		std::shared_ptr<const MappedFile> m_pFile{};
+		const char* m_pData{};
+		size_t m_Size{};
+		size_t m_Position{};
+		bool m_IsGood{ true };
+	};
+
+	//Traversal and shading index these arrays without checks, so a damaged snapshot must not get past here
+	bool IsValidTriangleMesh(std::span<const int> indices, size_t positionCount, size_t normalCount, const BVH& bvh, const TriangleSoA& triangles)
+	{
+		const size_t triangleCount{ indices.size() / 3 };
+		if (indices.size() % 3 != 0 || normalCount < triangleCount || triangles.data.size() != size_t{ triangles.stride } * TriangleSoA::ComponentCount)
+			return false;
+
+		for (const int index : indices)
+		{
+			if (index < 0 || static_cast<size_t>(index) >= positionCount)
+				return false;
+		}
+
+		return bvh.IsEmpty() || (bvh.GetPrimitiveIndices().size() == triangleCount && triangles.stride >= triangleCount + TriangleSoA::BlockSize);
+	}
+
+	bool IsValidCullMode(TriangleCullMode cullMode)
+	{
+		return cullMode == TriangleCullMode::FrontFaceCulling || cullMode == TriangleCullMode::BackFaceCulling || cullMode == TriangleCullMode::NoCulling;
+	}
+}
+
+bool Scene::SaveSnapshot(const std::string& filePath)
+{
+	//Every acceleration structure is stored built
+	UpdateAccelerationStructure();
+
+	//Written next to the target and renamed over it, processes that still map the old snapshot keep its pages
+	//and a failed save leaves the previous snapshot intact
+	const std::string tempPath{ filePath + ".tmp" };
+	std::error_code error{};
+	{
+		SnapshotWriter writer{ tempPath };
+		writer.Write(CreateHeader());
+		writer.WriteArray(std::vector<char>{ sceneName.begin(), sceneName.end() });
+		writer.Write(CameraRecord{ m_Camera.origin, m_Camera.fovAngle, m_Camera.forward, m_Camera.up, m_Camera.right, m_Camera.totalPitch, m_Camera.totalYaw });
+
+		std::vector<MaterialDescription> materials{};
+		materials.reserve(m_Materials.size());
+		for (const Material* pMaterial : m_Materials)
+		{
+			materials.push_back(pMaterial->GetDescription());
+		}
+		writer.WriteArray(materials);
+
+		writer.WriteArray(m_PlaneGeometries);
+		writer.WriteArray(m_SphereGeometries);
+		writer.WriteArray(m_Lights);
+
+		writer.WriteBVH(m_SphereBVH);
+		writer.WriteArray(m_Spheres.data);
+		writer.WriteArray(m_Spheres.materialIndices);
+		writer.Write(m_Spheres.stride);
+
+		writer.Write(uint32_t{ static_cast<uint32_t>(m_TriangleMeshGeometries.size()) });
+		for (const TriangleMesh& mesh : m_TriangleMeshGeometries)
+		{
+			writer.Write(TriangleMeshRecord{ mesh.materialIndex, mesh.cullMode, mesh.transformRevision,
+				ToRecord(mesh.rotationTransform), ToRecord(mesh.translationTransform), ToRecord(mesh.scaleTransform),
+				mesh.minAABB, mesh.maxAABB, mesh.transformedMinAABB, mesh.transformedMaxAABB });
+			writer.WriteArray(mesh.positions);
+			writer.WriteArray(mesh.normals);
+			writer.WriteArray(mesh.indices);
+			writer.WriteArray(mesh.transformedPositions);
+			writer.WriteArray(mesh.transformedNormals);
+			writer.WriteBVH(mesh.bvh);
+			writer.WriteArray(mesh.triangles.data);
+			writer.Write(mesh.triangles.stride);
+		}
+
+		//Shared geometry is stored once, in the order the instances first use it
+		std::vector<const MeshGeometry*> geometries{};
+		std::vector<InstanceRecord> instances{};
+		instances.reserve(m_TriangleMeshInstances.size());
+		for (const TriangleMeshInstance& instance : m_TriangleMeshInstances)
+		{
+			const auto geometry{ std::find(geometries.begin(), geometries.end(), instance.pGeometry.get()) };
+			const uint32_t geometryIndex{ static_cast<uint32_t>(geometry - geometries.begin()) };
+			if (geometry == geometries.end())
+				geometries.push_back(instance.pGeometry.get());
+
+			instances.push_back(InstanceRecord{ geometryIndex, instance.materialIndex, instance.cullMode, instance.transformRevision,
+				ToRecord(instance.rotationTransform), ToRecord(instance.translationTransform), ToRecord(instance.scaleTransform),
+				ToRecord(instance.worldTransform), ToRecord(instance.inverseWorldTransform), instance.worldBounds });
+		}
+
+		writer.Write(uint32_t{ static_cast<uint32_t>(geometries.size()) });
+		for (const MeshGeometry* pGeometry : geometries)
+		{
+			writer.WriteArray(pGeometry->positions);
+			writer.WriteArray(pGeometry->normals);
+			writer.WriteArray(pGeometry->indices);
+			writer.WriteBVH(pGeometry->bvh);
+			writer.WriteArray(pGeometry->triangles.data);
+			writer.Write(pGeometry->triangles.stride);
+		}
+		writer.WriteArray(instances);
+
+		writer.WriteArray(m_BoundedGeometries);
+		writer.WriteArray(m_BoundedGeometryBounds);
+		writer.WriteBVH(m_TopLevelBVH);
+		if (!writer.Close())
+		{
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, filePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool Scene::LoadSnapshot(const std::string& filePath)
+{
+	const std::shared_ptr<MappedFile> pFile{ std::make_shared<MappedFile>() };
+	if (!pFile->Open(filePath))
+		return false;
+
+	SnapshotReader reader{ pFile };
+	SnapshotHeader header{};
+	const SnapshotHeader expectedHeader{ CreateHeader() };
+	if (!reader.Read(header) || std::memcmp(&header, &expectedHeader, sizeof(header)) != 0)
+		return false;
+
+	//Everything is read into locals first, the scene only changes once the whole snapshot checked out
+	std::vector<char> name{};
+	CameraRecord camera{};
+	std::vector<MaterialDescription> materials{};
+	std::vector<Plane> planes{};
+	std::vector<Sphere> spheres{};
+	std::vector<Light> lights{};
+	BVH sphereBVH{};
+	SphereSoA sphereBlocks{};
+	reader.ReadArray(name);
+	reader.Read(camera);
+	reader.ReadArray(materials);
+	reader.ReadArray(planes);
+	reader.ReadArray(spheres);
+	reader.ReadArray(lights);
+	reader.ReadBVH(sphereBVH);
+	reader.ReadArray(sphereBlocks.data);
+	reader.ReadArray(sphereBlocks.materialIndices);
+	reader.Read(sphereBlocks.stride);
+
+	//Material indices are stored in an unsigned char
+	const size_t materialCount{ materials.size() };
+	bool isValid{ reader.IsGood() && materialCount > 0 && materialCount <= size_t{ UINT8_MAX } + 1 };
+	for (const MaterialDescription& material : materials)
+	{
+		isValid = isValid && material.type >= MaterialType::SolidColor && material.type <= MaterialType::CookTorrence;
+	}
+	for (const Plane& plane : planes)
+	{
+		isValid = isValid && plane.materialIndex < materialCount;
+	}
+	for (const Sphere& sphere : spheres)
+	{
+		isValid = isValid && sphere.materialIndex < materialCount;
+	}
+	for (const unsigned char materialIndex : sphereBlocks.materialIndices)
+	{
+		isValid = isValid && materialIndex < materialCount;
+	}
+	isValid = isValid && sphereBlocks.data.size() == size_t{ sphereBlocks.stride } * SphereSoA::ComponentCount
+		&& (sphereBVH.IsEmpty() || (sphereBVH.GetPrimitiveIndices().size() == spheres.size()
+			&& sphereBlocks.materialIndices.size() == spheres.size() && sphereBlocks.stride >= spheres.size() + SphereSoA::BlockSize));
+
+	uint32_t meshCount{};
+	reader.Read(meshCount);
+	std::vector<TriangleMesh> meshes{};
+	for (uint32_t meshIndex{ 0 }; isValid && reader.IsGood() && meshIndex < meshCount; ++meshIndex)
+	{
+		TriangleMeshRecord record{};
+		TriangleMesh& mesh = meshes.emplace_back();
+		reader.Read(record);
+		reader.ReadArray(mesh.positions);
+		reader.ReadArray(mesh.normals);
+		reader.ReadArray(mesh.indices);
+		reader.ReadArray(mesh.transformedPositions);
+		reader.ReadArray(mesh.transformedNormals);
+		reader.ReadBVH(mesh.bvh);
+		reader.ReadArray(mesh.triangles.data);
+		reader.Read(mesh.triangles.stride);
+
+		mesh.materialIndex = record.materialIndex;
+		mesh.cullMode = record.cullMode;
+		mesh.transformRevision = record.transformRevision;
+		mesh.rotationTransform = FromRecord(record.rotationTransform);
+		mesh.translationTransform = FromRecord(record.translationTransform);
+		mesh.scaleTransform = FromRecord(record.scaleTransform);
+		mesh.minAABB = record.minAABB;
+		mesh.maxAABB = record.maxAABB;
+		mesh.transformedMinAABB = record.transformedMinAABB;
+		mesh.transformedMaxAABB = record.transformedMaxAABB;
+		//A mesh moved after loading refits and rebuilds the same way it was built
+		mesh.bvh.SetMaxLeafSize(TriangleSoA::BlockSize);
+
+		isValid = reader.IsGood() && mesh.materialIndex < materialCount && IsValidCullMode(mesh.cullMode)
+			&& mesh.transformedPositions.size() == mesh.positions.size() && mesh.transformedNormals.size() == mesh.normals.size()
+			&& IsValidTriangleMesh(mesh.indices, mesh.positions.size(), mesh.normals.size(), mesh.bvh, mesh.triangles);
+	}
+
+	uint32_t geometryCount{};
+	reader.Read(geometryCount);
+	std::vector<std::shared_ptr<const MeshGeometry>> geometries{};
+	for (uint32_t geometryIndex{ 0 }; isValid && reader.IsGood() && geometryIndex < geometryCount; ++geometryIndex)
+	{
+		const std::shared_ptr<MeshGeometry> pGeometry{ std::make_shared<MeshGeometry>() };
+		reader.ReadArray(pGeometry->positions);
+		reader.ReadArray(pGeometry->normals);
+		reader.ReadArray(pGeometry->indices);
+		reader.ReadBVH(pGeometry->bvh);
+		reader.ReadArray(pGeometry->triangles.data);
+		reader.Read(pGeometry->triangles.stride);
+
+		isValid = reader.IsGood() && IsValidTriangleMesh(pGeometry->indices, pGeometry->positions.size(), pGeometry->normals.size(), pGeometry->bvh, pGeometry->triangles);
+		geometries.push_back(pGeometry);
+	}
+
+	std::vector<InstanceRecord> instanceRecords{};
+	std::vector<BoundedGeometry> boundedGeometries{};
+	std::vector<AABB> boundedGeometryBounds{};
+	BVH topLevelBVH{};
+	reader.ReadArray(instanceRecords);
+	reader.ReadArray(boundedGeometries);
+	reader.ReadArray(boundedGeometryBounds);
+	reader.ReadBVH(topLevelBVH);
+
+	isValid = isValid && reader.IsGood() && meshes.size() == meshCount && geometries.size() == geometryCount
+		&& boundedGeometryBounds.size() == boundedGeometries.size()
+		&& (topLevelBVH.IsEmpty() || topLevelBVH.GetPrimitiveIndices().size() == boundedGeometries.size());
+	for (const InstanceRecord& record : instanceRecords)
+	{
+		isValid = isValid && record.geometryIndex < geometryCount && record.materialIndex < materialCount && IsValidCullMode(record.cullMode);
+	}
+	for (const BoundedGeometry& geometry : boundedGeometries)
+	{
+		switch (geometry.type)
+		{
+		case GeometryType::Spheres:
+			isValid = isValid && !sphereBVH.IsEmpty();
+			break;
+		case GeometryType::TriangleMesh:
+			isValid = isValid && geometry.index < meshCount;
+			break;
+		case GeometryType::TriangleMeshInstance:
+			isValid = isValid && geometry.index < instanceRecords.size();
+			break;
+		default:
+			isValid = false;
+			break;
+		}
+	}
+
+	if (!isValid)
+		return false;
+
+	sceneName.assign(name.begin(), name.end());
+	m_Camera.origin = camera.origin;
+	m_Camera.fovAngle = camera.fovAngle;
+	m_Camera.forward = camera.forward;
+	m_Camera.up = camera.up;
+	m_Camera.right = camera.right;
+	m_Camera.totalPitch = camera.totalPitch;
+	m_Camera.totalYaw = camera.totalYaw;
+
+	for (Material* pMaterial : m_Materials)
+	{
+		delete pMaterial;
+	}
+	m_Materials.clear();
+	for (const MaterialDescription& material : materials)
+	{
+		m_Materials.push_back(CreateMaterial(material));
+	}
+
+	m_PlaneGeometries = std::move(planes);
+	m_SphereGeometries = std::move(spheres);
+	m_Lights = std::move(lights);
+	m_SphereBVH = std::move(sphereBVH);
+	m_SphereBVH.SetMaxLeafSize(SphereSoA::BlockSize);
+	m_Spheres = std::move(sphereBlocks);
+	m_TriangleMeshGeometries = std::move(meshes);
+
+	m_TriangleMeshInstances.clear();
+	m_TriangleMeshInstances.reserve(instanceRecords.size());
+	for (const InstanceRecord& record : instanceRecords)
+	{
+		TriangleMeshInstance& instance = m_TriangleMeshInstances.emplace_back();
+		instance.pGeometry = geometries[record.geometryIndex];
+		instance.materialIndex = record.materialIndex;
+		instance.cullMode = record.cullMode;
+		instance.rotationTransform = FromRecord(record.rotationTransform);
+		instance.translationTransform = FromRecord(record.translationTransform);
+		instance.scaleTransform = FromRecord(record.scaleTransform);
+		instance.worldTransform = FromRecord(record.worldTransform);
+		instance.inverseWorldTransform = FromRecord(record.inverseWorldTransform);
+		instance.worldBounds = record.worldBounds;
+		instance.transformRevision = record.transformRevision;
+	}
+
+	m_BoundedGeometries = std::move(boundedGeometries);
+	m_BoundedGeometryBounds = std::move(boundedGeometryBounds);
+	m_TopLevelBVH = std::move(topLevelBVH);
+	m_IsTopLevelDirty = false;
+	m_AreSpheresDirty = false;
+	return true;
+}
+
+Scene_Snapshot::Scene_Snapshot(const std::string& filePath) :
+	m_FilePath{ filePath }
+{
+}
+
+void Scene_Snapshot::Initialize()
+{
+	if (!LoadSnapshot(m_FilePath))
+		std::cerr << m_FilePath << ": could not load the scene snapshot\n";
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+
+#include "Scene.h"
+
+namespace dae
+{
+	//Scene loaded from a snapshot written by Scene::SaveSnapshot
+	//The file stays mapped read-only and the BVHs, triangle and sphere blocks and mesh geometry are read in place, nothing gets parsed or built
+	//Render processes on the same machine share those pages, a mesh only gets a private copy once a refit or rebuild writes to it
+	class Scene_Snapshot final : public Scene
+	{
+	public:
+		explicit Scene_Snapshot(const std::string& filePath);
+		~Scene_Snapshot() override = default;
+
+		Scene_Snapshot(const Scene_Snapshot&) = delete;
+		Scene_Snapshot(Scene_Snapshot&&) noexcept = delete;
+		Scene_Snapshot& operator=(const Scene_Snapshot&) = delete;
+		Scene_Snapshot& operator=(Scene_Snapshot&&) noexcept = delete;
+
+		//A snapshot that can not be loaded is reported on std::cerr and leaves the scene empty
+		void Initialize() override;
+
+	private:
+		std::string m_FilePath{};
+	};
+}
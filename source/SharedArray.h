@@ -0,0 +1,63 @@
+#pragma once
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace dae
+{
+	//Read-only array that owns its elements or borrows them from memory another object keeps alive, like a mapped snapshot
+	//Borrowed elements stay in the file cache pages every process mapping the file shares, Edit copies them before the first write
+	template<typename T>
+	class SharedArray final
+	{
+	public:
+		SharedArray() = default;
+		SharedArray(std::vector<T>&& elements) :
+			m_Elements{ std::move(elements) }
+		{
+		}
+		//pOwner keeps the borrowed memory alive for as long as the array borrows it
+		SharedArray(std::span<const T> elements, std::shared_ptr<const void> pOwner) :
+			m_BorrowedElements{ elements },
+			m_pOwner{ std::move(pOwner) }
+		{
+		}
+
+		SharedArray& operator=(std::vector<T>&& elements)
+		{
+			m_Elements = std::move(elements);
+			m_BorrowedElements = {};
+			m_pOwner.reset();
+			return *this;
+		}
+
+		//Owned elements to write to, borrowed elements are copied into them first
+		std::vector<T>& Edit()
+		{
+			if (m_pOwner)
+			{
+				m_Elements.assign(m_BorrowedElements.begin(), m_BorrowedElements.end());
+				m_BorrowedElements = {};
+				m_pOwner.reset();
+			}
+			return m_Elements;
+		}
+
+		bool IsBorrowed() const { return m_pOwner != nullptr; }
+
+		//Named like the std containers, so the array reads like the vectors it replaces
+		const T* data() const { return m_pOwner ? m_BorrowedElements.data() : m_Elements.data(); }
+		size_t size() const { return m_pOwner ? m_BorrowedElements.size() : m_Elements.size(); }
+		bool empty() const { return size() == 0; }
+		const T& operator[](size_t index) const { return data()[index]; }
+		const T* begin() const { return data(); }
+		const T* end() const { return data() + size(); }
+
+		operator std::span<const T>() const { return { data(), size() }; }
+
+	private:
+		std::vector<T> m_Elements{};
+		std::span<const T> m_BorrowedElements{};
+		std::shared_ptr<const void> m_pOwner{};
+	};
+}
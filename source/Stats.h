@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+
+//Hot path instrumentation: rays, BVH node visits, primitive tests and shading calls
+//Every thread counts into its own thread local block, the Renderer stores the difference each tile made and merges the tiles after the frame
+//With RAYTRACER_ENABLE_STATS set to 0 the RAYTRACER_STAT_* macros compile to nothing and every block reads as zero
+#ifndef RAYTRACER_ENABLE_STATS
+#define RAYTRACER_ENABLE_STATS 1
+#endif
+
+namespace dae
+{
+	enum class StatCounter
+	{
+		PrimaryRays,
+		ShadowRays,
+		NodeVisits, //4-wide BVH nodes tested, by single rays and by packets
+		PrimitiveTests, //Spheres, triangles and planes tested
+		ShadingCalls, //Material::Shade calls
+		Count
+	};
+
+	//A cache line of its own, so blocks written by different threads never share one
+	struct alignas(64) StatBlock
+	{
+		uint64_t counts[static_cast<int>(StatCounter::Count)]{};
+
+		uint64_t& operator[](StatCounter counter) { return counts[static_cast<int>(counter)]; }
+		uint64_t operator[](StatCounter counter) const { return counts[static_cast<int>(counter)]; }
+
+		StatBlock& operator+=(const StatBlock& other)
+		{
+			for (int i{ 0 }; i < static_cast<int>(StatCounter::Count); ++i)
+			{
+				counts[i] += other.counts[i];
+			}
+			return *this;
+		}
+
+		StatBlock operator-(const StatBlock& other) const
+		{
+			StatBlock difference{};
+			for (int i{ 0 }; i < static_cast<int>(StatCounter::Count); ++i)
+			{
+				difference.counts[i] = counts[i] - other.counts[i];
+			}
+			return difference;
+		}
+	};
+
+#if RAYTRACER_ENABLE_STATS
+	//Counters of the calling thread, only ever written by that thread and never reset
+	inline thread_local StatBlock g_ThreadStats{};
+
+#define RAYTRACER_STAT_ADD(counter, amount) (::dae::g_ThreadStats.counts[static_cast<int>(::dae::StatCounter::counter)] += (amount))
+#else
+#define RAYTRACER_STAT_ADD(counter, amount) ((void)0)
+#endif
+#define RAYTRACER_STAT_INC(counter) RAYTRACER_STAT_ADD(counter, 1)
+
+	//Snapshot of the calling thread's counters, the difference of two snapshots is the work done in between
+	inline StatBlock GetThreadStats()
+	{
+#if RAYTRACER_ENABLE_STATS
+		return g_ThreadStats;
+#else
+		return StatBlock{};
+#endif
+	}
+}
@@ -0,0 +1,186 @@
+//Regression tests run by ctest, every test is one function returning false on failure
+//Tests run from the build directory, where the Resources are copied to
+
+//Standard includes
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+//Project includes
+#include "BVH.h"
+#include "DataTypes.h"
+#include "MeshCache.h"
+#include "OBJParser.h"
+#include "SceneFile.h"
+#include "Timer.h"
+
+using namespace dae;
+
+namespace
+{
+	std::vector<BVHNode> CreateChain(uint32_t depth)
+	{
+		//Every interior node has a leaf on the left and the next interior node on the right
+		std::vector<BVHNode> nodes(size_t{ depth } * 2 + 1);
+		for (uint32_t i{ 0 }; i < depth; ++i)
+		{
+			nodes[i * 2].leftFirst = i * 2 + 1;
+			nodes[i * 2 + 1].primitiveCount = 1;
+		}
+		nodes.back().primitiveCount = 1;
+		return nodes;
+	}
+
+	std::vector<BVH4Node> CreateWideLeaf()
+	{
+		//One leaf lane, the unused lanes get inverted bounds like Collapse gives them
+		std::vector<BVH4Node> wideNodes(1);
+		for (int lane{ 1 }; lane < 4; ++lane)
+		{
+			wideNodes[0].bounds[0][lane] = wideNodes[0].bounds[1][lane] = wideNodes[0].bounds[2][lane] = FLT_MAX;
+			wideNodes[0].bounds[3][lane] = wideNodes[0].bounds[4][lane] = wideNodes[0].bounds[5][lane] = -FLT_MAX;
+		}
+		wideNodes[0].primitiveCount[0] = 1;
+		return wideNodes;
+	}
+
+	bool TestLoadRejectsBinaryCycle()
+	{
+		std::vector<BVHNode> nodes{ CreateChain(2) };
+		nodes[2].leftFirst = 1;
+
+		BVH bvh{};
+		return !bvh.Load(std::move(nodes), CreateWideLeaf(), std::vector<uint32_t>{ 0 });
+	}
+
+	bool TestLoadRejectsDeepTree()
+	{
+		BVH validBvh{};
+		BVH deepBvh{};
+		return validBvh.Load(CreateChain(BVH::MaxDepth - 1), CreateWideLeaf(), std::vector<uint32_t>{ 0 })
+			&& !deepBvh.Load(CreateChain(BVH::MaxDepth), CreateWideLeaf(), std::vector<uint32_t>{ 0 });
+	}
+
+	bool TestCacheRejectsSelfReferencingWideNode()
+	{
+		const std::filesystem::path cachePath{ std::filesystem::temp_directory_path() / "RayTracerTests_SelfReference.rtmesh" };
+		constexpr uint64_t sourceHash{ 1 };
+
+		MeshGeometry geometry{};
+		if (!MeshCache::LoadOBJ("Resources/lowpoly_bunny.obj", geometry) || !MeshCache::Save(cachePath.string(), sourceHash, geometry))
+		{
+			std::cerr << "could not write " << cachePath.string() << '\n';
+			return false;
+		}
+
+		//Point every interior lane of the wide root back at the root
+		BVH4Node root{ geometry.bvh.GetWideNodes().front() };
+		const BVH4Node originalRoot{ root };
+		for (int lane{ 0 }; lane < 4; ++lane)
+		{
+			if (root.primitiveCount[lane] == 0)
+				root.child[lane] = 0;
+		}
+
+		std::ifstream input{ cachePath, std::ios::binary };
+		std::string bytes{ std::istreambuf_iterator<char>{ input }, std::istreambuf_iterator<char>{} };
+		input.close();
+		const size_t rootOffset{ bytes.find(std::string{ reinterpret_cast<const char*>(&originalRoot), sizeof(BVH4Node) }) };
+		if (rootOffset == std::string::npos)
+		{
+			std::cerr << "could not find the wide root in the cache\n";
+			return false;
+		}
+		std::memcpy(bytes.data() + rootOffset, &root, sizeof(BVH4Node));
+		std::ofstream{ cachePath, std::ios::binary }.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+
+		MeshGeometry loadedGeometry{};
+		const bool isLoaded{ MeshCache::Load(cachePath.string(), sourceHash, loadedGeometry) };
+		std::filesystem::remove(cachePath);
+		return !isLoaded;
+	}
+
+	bool TestOBJTrailingComments()
+	{
+		const std::filesystem::path objPath{ std::filesystem::temp_directory_path() / "RayTracerTests_Comments.obj" };
+		std::ofstream{ objPath } << "# triangle\nv 0 0 0 # origin\nv 1 0 0\nv 0 1 0#tight\nf 1 2 3 # note\n";
+
+		std::vector<Vector3> positions{}, normals{};
+		std::vector<int> indices{};
+		const bool isParsed{ Utils::ParseOBJ(objPath.string(), positions, normals, indices, 1) };
+		std::filesystem::remove(objPath);
+		return isParsed && positions.size() == 3 && indices == std::vector<int>{ 0, 1, 2 };
+	}
+
+	bool TestOBJRejectsOutOfRangeNormals()
+	{
+		const std::filesystem::path objPath{ std::filesystem::temp_directory_path() / "RayTracerTests_Normals.obj" };
+		const auto parseFace = [&objPath](const char* pFace)
+			{
+				std::ofstream{ objPath } << "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\n" << pFace << '\n';
+				std::vector<Vector3> positions{}, normals{};
+				std::vector<int> indices{};
+				return Utils::ParseOBJ(objPath.string(), positions, normals, indices, 1);
+			};
+
+		const bool isValid{ parseFace("f 1//1 2//-1 3//1") && !parseFace("f 1//-5 2//1 3//1") && !parseFace("f 1//5 2//1 3//1") };
+		std::filesystem::remove(objPath);
+		return isValid;
+	}
+
+	bool TestSceneFileKeepsSceneOnInvalidReload()
+	{
+		const std::filesystem::path scenePath{ std::filesystem::temp_directory_path() / "RayTracerTests_Reload.scene" };
+		constexpr const char* pMaterial{ "material red lambert 1 0 0 1\n" };
+		std::ofstream{ scenePath } << pMaterial << "sphere 0 0 0 1 red\nsphere 2 0 0 1 red\n";
+
+		Scene_File scene{ scenePath.string() };
+		scene.Initialize();
+		Timer timer{};
+		const auto reload = [&](const std::string& content)
+			{
+				std::ofstream{ scenePath } << content;
+				scene.Update(&timer);
+				return scene.GetSphereGeometries().size();
+			};
+
+		//A misspelled material keeps both spheres, the corrected save applies
+		const bool isValid{ scene.GetSphereGeometries().size() == 2
+			&& reload(std::string{ pMaterial } + "sphere 0 0 0 1 rde\n") == 2
+			&& reload(std::string{ pMaterial } + "sphere 0 0 0 1 red\n") == 1 };
+		std::filesystem::remove(scenePath);
+		return isValid;
+	}
+}
+
+int main()
+{
+	struct Test
+	{
+		const char* name;
+		bool (*pFunction)();
+	};
+	const Test tests[]
+	{
+		{ "BVH::Load rejects a binary cycle", TestLoadRejectsBinaryCycle },
+		{ "BVH::Load rejects a tree deeper than MaxDepth", TestLoadRejectsDeepTree },
+		{ "MeshCache::Load rejects a self-referencing wide node", TestCacheRejectsSelfReferencingWideNode },
+		{ "ParseOBJ ignores comments behind statements", TestOBJTrailingComments },
+		{ "ParseOBJ rejects vn indices out of range", TestOBJRejectsOutOfRangeNormals },
+		{ "Scene_File keeps the scene when a reload has errors", TestSceneFileKeepsSceneOnInvalidReload },
+	};
+
+	int failedCount{ 0 };
+	for (const Test& test : tests)
+	{
+		const bool isPassed{ test.pFunction() };
+		std::cout << (isPassed ? "passed: " : "FAILED: ") << test.name << '\n';
+		failedCount += isPassed ? 0 : 1;
+	}
+	return failedCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <string>
+
+#include "Trace.h"
+
+using namespace dae;
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	m_pQueues = std::make_unique<WorkQueue[]>(threadCount);
+
+	//The thread calling ParallelFor is thread 0
+	m_Workers.reserve(threadCount - 1);
+	for (uint32_t i{ 1 }; i < threadCount; ++i)
+	{
+		m_Workers.emplace_back([this, i] { WorkerLoop(i); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_IsStopping = true;
+	}
+	m_WorkCondition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::ParallelFor(uint32_t jobCount, const std::function<void(uint32_t)>& job)
+{
+	if (jobCount == 0)
+		return;
+
+	if (m_Workers.empty() || jobCount == 1)
+	{
+		for (uint32_t i{ 0 }; i < jobCount; ++i)
+		{
+			job(i);
+		}
+		return;
+	}
+
+	m_NextJob.store(0, std::memory_order_relaxed);
+	Dispatch(job, jobCount, false);
+}
+
+void ThreadPool::ParallelFor(const std::vector<std::vector<uint32_t>>& jobsPerThread, const std::function<void(uint32_t)>& job)
+{
+	//Lists beyond the thread count are handed to the last thread
+	const uint32_t threadCount{ GetThreadCount() };
+	for (uint32_t threadIndex{ 0 }; threadIndex < threadCount; ++threadIndex)
+	{
+		m_pQueues[threadIndex].jobs.clear();
+	}
+	for (size_t list{ 0 }; list < jobsPerThread.size(); ++list)
+	{
+		std::vector<uint32_t>& jobs = m_pQueues[std::min(static_cast<uint32_t>(list), threadCount - 1)].jobs;
+		jobs.insert(jobs.end(), jobsPerThread[list].begin(), jobsPerThread[list].end());
+	}
+	for (uint32_t threadIndex{ 0 }; threadIndex < threadCount; ++threadIndex)
+	{
+		WorkQueue& queue = m_pQueues[threadIndex];
+		queue.front = 0;
+		queue.back = static_cast<uint32_t>(queue.jobs.size());
+	}
+
+	if (m_Workers.empty())
+	{
+		RunQueuedJobs(0, job);
+		return;
+	}
+
+	Dispatch(job, 0, true);
+}
+
+void ThreadPool::Dispatch(const std::function<void(uint32_t)>& job, uint32_t jobCount, bool isStealing)
+{
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_pJob = &job;
+		m_JobCount = jobCount;
+		m_IsStealing = isStealing;
+		++m_Generation;
+	}
+	m_WorkCondition.notify_all();
+
+	RunJobs(0, job, jobCount, isStealing);
+
+	//Workers that woke up late find no jobs left, but may still be reading the job
+	std::unique_lock lock{ m_Mutex };
+	m_DoneCondition.wait(lock, [this] { return m_BusyWorkers == 0; });
+	m_pJob = nullptr;
+	m_JobCount = 0;
+}
+
+void ThreadPool::WorkerLoop(uint32_t threadIndex)
+{
+	Trace::SetThreadName("Worker " + std::to_string(threadIndex));
+	uint64_t seenGeneration{ 0 };
+
+	while (true)
+	{
+		const std::function<void(uint32_t)>* pJob{};
+		uint32_t jobCount{};
+		bool isStealing{};
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_WorkCondition.wait(lock, [&] { return m_IsStopping || m_Generation != seenGeneration; });
+			if (m_IsStopping)
+				return;
+
+			seenGeneration = m_Generation;
+			//Woke up after the ParallelFor already returned
+			if (!m_pJob)
+				continue;
+
+			pJob = m_pJob;
+			jobCount = m_JobCount;
+			isStealing = m_IsStealing;
+			++m_BusyWorkers;
+		}
+
+		RunJobs(threadIndex, *pJob, jobCount, isStealing);
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			--m_BusyWorkers;
+		}
+		m_DoneCondition.notify_one();
+	}
+}
+
+void ThreadPool::RunJobs(uint32_t threadIndex, const std::function<void(uint32_t)>& job, uint32_t jobCount, bool isStealing)
+{
+	if (isStealing)
+	{
+		RunQueuedJobs(threadIndex, job);
+		return;
+	}
+
+	//Every index is handed out exactly once, whichever thread asks first gets it
+	for (uint32_t i{ m_NextJob.fetch_add(1, std::memory_order_relaxed) }; i < jobCount;
+		i = m_NextJob.fetch_add(1, std::memory_order_relaxed))
+	{
+		job(i);
+	}
+}
+
+void ThreadPool::RunQueuedJobs(uint32_t threadIndex, const std::function<void(uint32_t)>& job)
+{
+	const uint32_t threadCount{ GetThreadCount() };
+
+	//Own queue first, in the order it was given
+	WorkQueue& ownQueue = m_pQueues[threadIndex];
+	while (true)
+	{
+		uint32_t jobIndex{};
+		{
+			std::lock_guard lock{ ownQueue.mutex };
+			if (ownQueue.front == ownQueue.back)
+				break;
+			jobIndex = ownQueue.jobs[ownQueue.front++];
+		}
+		job(jobIndex);
+	}
+
+	//Then steal from the back of the other queues, the jobs their owners would reach last
+	//No jobs are added during a ParallelFor, so once every queue is empty this thread is done
+	for (uint32_t offset{ 1 }; offset < threadCount; ++offset)
+	{
+		WorkQueue& victimQueue = m_pQueues[(threadIndex + offset) % threadCount];
+		while (true)
+		{
+			uint32_t jobIndex{};
+			{
+				std::lock_guard lock{ victimQueue.mutex };
+				if (victimQueue.front == victimQueue.back)
+					break;
+				jobIndex = victimQueue.jobs[--victimQueue.back];
+			}
+			job(jobIndex);
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//Persistent worker threads that run indexed jobs, portable replacement for concurrency::parallel_for
+	//Jobs are either claimed from a shared atomic counter, or taken from per-thread queues that idle threads steal from
+	class ThreadPool final
+	{
+	public:
+		/**
+		 * \brief Starts the workers, they sleep until ParallelFor hands them work
+		 * \param threadCount threads working on a ParallelFor including the calling thread, 0 uses every hardware thread
+		 */
+		explicit ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		/**
+		 * \brief Runs job(index) for every index in [0, jobCount), the calling thread helps and returns once all jobs finished
+		 * \param jobCount amount of jobs
+		 * \param job called once per index from any of the threads, must be safe to run concurrently
+		 */
+		void ParallelFor(uint32_t jobCount, const std::function<void(uint32_t)>& job);
+		/**
+		 * \brief Runs job(index) for every index in jobsPerThread, returns once all jobs finished
+		 * Every thread works through its own list front to back, then steals from the back of the other lists
+		 * \param jobsPerThread one list of job indices per thread (GetThreadCount lists), list 0 belongs to the calling thread
+		 * \param job called once per index from any of the threads, must be safe to run concurrently
+		 */
+		void ParallelFor(const std::vector<std::vector<uint32_t>>& jobsPerThread, const std::function<void(uint32_t)>& job);
+
+		//Threads working on a ParallelFor, the calling thread included
+		uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Workers.size()) + 1; }
+
+	private:
+		//Jobs [front, back) are left, the owner takes from the front and thieves from the back
+		//Own cache line each, so owners popping jobs do not invalidate each other's queue
+		struct alignas(64) WorkQueue
+		{
+			std::mutex mutex{};
+			std::vector<uint32_t> jobs{};
+			uint32_t front{};
+			uint32_t back{};
+		};
+
+		std::vector<std::thread> m_Workers{};
+		std::unique_ptr<WorkQueue[]> m_pQueues{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WorkCondition{};
+		std::condition_variable m_DoneCondition{};
+
+		//Current ParallelFor, guarded by m_Mutex except for the atomic claim counter and the queues
+		const std::function<void(uint32_t)>* m_pJob{};
+		uint32_t m_JobCount{};
+		bool m_IsStealing{ false };
+		std::atomic<uint32_t> m_NextJob{};
+		//Incremented per ParallelFor so sleeping workers can tell new work arrived
+		uint64_t m_Generation{};
+		//Workers still inside the current ParallelFor
+		uint32_t m_BusyWorkers{};
+		bool m_IsStopping{ false };
+
+		void Dispatch(const std::function<void(uint32_t)>& job, uint32_t jobCount, bool isStealing);
+		void WorkerLoop(uint32_t threadIndex);
+		void RunJobs(uint32_t threadIndex, const std::function<void(uint32_t)>& job, uint32_t jobCount, bool isStealing);
+		void RunQueuedJobs(uint32_t threadIndex, const std::function<void(uint32_t)>& job);
+	};
+}
@@ -21,6 +21,10 @@ namespace dae
 		void Update();
 		void Stop();
 
+		//Every Update advances the timer by timeStep seconds instead of the measured time, 0 uses the clock again
+		//Keeps scene animation reproducible no matter how long a frame took to render
+		void SetFixedTimeStep(float timeStep) { m_FixedTimeStep = timeStep; }
+
 		uint32_t GetFPS() const { return m_FPS; };
 		float GetdFPS() const { return m_dFPS; };
 		float GetElapsed() const { return m_ElapsedTime; };
@@ -43,6 +47,8 @@ namespace dae
 		float m_SecondsPerCount = 0.0f;
 		float m_ElapsedUpperBound = 0.03f;
 		float m_FPSTimer = 0.0f;
+		float m_FixedTimeStep = 0.0f;
+		float m_SimulatedTime = 0.0f;
 
 		bool m_IsStopped = true;
 		bool m_ForceElapsedUpperBound = false;
@@ -0,0 +1,172 @@
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Json.h"
+
+using namespace dae;
+
+namespace
+{
+	struct TraceEvent
+	{
+		const char* pName;
+		int64_t startTime;
+		int64_t duration;
+		int64_t argument;
+		uint32_t threadId;
+	};
+
+	//Events per thread, a power of two so the write position wraps with a mask
+	constexpr uint64_t g_BufferCapacity{ 1 << 15 };
+
+	struct ThreadBuffer
+	{
+		//Allocated on the first event, threads that only name themselves stay small
+		std::vector<TraceEvent> events{};
+		//Events ever written, the last g_BufferCapacity of them are still in the buffer
+		uint64_t writeCount{};
+		uint32_t threadId{};
+		bool isInUse{};
+	};
+
+	std::atomic<bool> g_IsEnabled{ false };
+	const std::chrono::steady_clock::time_point g_StartTime{ std::chrono::steady_clock::now() };
+
+	//Guards the buffer list and thread names, recording itself only touches the calling thread's buffer
+	std::mutex g_Mutex{};
+	std::vector<std::unique_ptr<ThreadBuffer>> g_Buffers{};
+	std::vector<std::pair<uint32_t, std::string>> g_ThreadNames{};
+	uint32_t g_NextThreadId{ 1 };
+
+	//Hands the buffer back when its thread exits, the next new thread reuses it and the recorded events are kept
+	struct ThreadBufferHandle
+	{
+		ThreadBuffer* pBuffer{};
+
+		~ThreadBufferHandle()
+		{
+			if (!pBuffer)
+				return;
+
+			std::lock_guard lock{ g_Mutex };
+			pBuffer->isInUse = false;
+		}
+	};
+	thread_local ThreadBufferHandle t_BufferHandle{};
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		if (t_BufferHandle.pBuffer)
+			return *t_BufferHandle.pBuffer;
+
+		std::lock_guard lock{ g_Mutex };
+		ThreadBuffer* pBuffer{};
+		for (const std::unique_ptr<ThreadBuffer>& pFreeBuffer : g_Buffers)
+		{
+			if (!pFreeBuffer->isInUse)
+			{
+				pBuffer = pFreeBuffer.get();
+				break;
+			}
+		}
+		if (!pBuffer)
+		{
+			g_Buffers.push_back(std::make_unique<ThreadBuffer>());
+			pBuffer = g_Buffers.back().get();
+		}
+
+		pBuffer->isInUse = true;
+		pBuffer->threadId = g_NextThreadId++;
+		t_BufferHandle.pBuffer = pBuffer;
+		return *pBuffer;
+	}
+}
+
+void Trace::SetEnabled(bool isEnabled)
+{
+	g_IsEnabled.store(isEnabled, std::memory_order_relaxed);
+}
+
+bool Trace::IsEnabled()
+{
+	return g_IsEnabled.load(std::memory_order_relaxed);
+}
+
+void Trace::SetThreadName(const std::string& name)
+{
+	const uint32_t threadId{ GetThreadBuffer().threadId };
+
+	std::lock_guard lock{ g_Mutex };
+	g_ThreadNames.emplace_back(threadId, name);
+}
+
+int64_t Trace::GetTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_StartTime).count();
+}
+
+void Trace::Record(const char* pName, int64_t startTime, int64_t endTime, int64_t argument)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	if (buffer.events.empty())
+		buffer.events.resize(g_BufferCapacity);
+
+	buffer.events[buffer.writeCount & (g_BufferCapacity - 1)] = TraceEvent{ pName, startTime, endTime - startTime, argument, buffer.threadId };
+	++buffer.writeCount;
+}
+
+bool Trace::SaveToFile(const std::string& filePath)
+{
+	std::ofstream file{ filePath };
+	if (!file)
+		return false;
+
+	std::lock_guard lock{ g_Mutex };
+	file << std::fixed << std::setprecision(3);
+
+	//Complete events ("X") with microsecond timestamps, one row per thread id
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"RayTracer\"}}";
+
+	for (const auto& [threadId, name] : g_ThreadNames)
+	{
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId << ",\"args\":{\"name\":\"";
+		Json::WriteEscaped(file, name);
+		file << "\"}}";
+	}
+
+	for (const std::unique_ptr<ThreadBuffer>& pBuffer : g_Buffers)
+	{
+		const uint64_t firstEvent{ pBuffer->writeCount > g_BufferCapacity ? pBuffer->writeCount - g_BufferCapacity : 0 };
+		for (uint64_t eventIndex{ firstEvent }; eventIndex < pBuffer->writeCount; ++eventIndex)
+		{
+			const TraceEvent& event = pBuffer->events[eventIndex & (g_BufferCapacity - 1)];
+			file << ",\n{\"name\":\"";
+			Json::WriteEscaped(file, event.pName);
+			file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId
+				<< ",\"ts\":" << event.startTime / 1000.0 << ",\"dur\":" << event.duration / 1000.0;
+			if (event.argument >= 0)
+				file << ",\"args\":{\"index\":" << event.argument << '}';
+			file << '}';
+		}
+	}
+
+	file << "\n]}\n";
+	return file.good();
+}
+
+void Trace::Clear()
+{
+	std::lock_guard lock{ g_Mutex };
+	for (const std::unique_ptr<ThreadBuffer>& pBuffer : g_Buffers)
+	{
+		pBuffer->writeCount = 0;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace dae
+{
+	//Timeline of scoped events, every thread records into its own ring buffer without locking
+	//SaveToFile writes the Chrome trace_event JSON that chrome://tracing and Perfetto open
+	namespace Trace
+	{
+		//Recording starts disabled, a disabled TraceScope only reads this flag
+		void SetEnabled(bool isEnabled);
+		bool IsEnabled();
+
+		//Name of the calling thread's row in the timeline
+		void SetThreadName(const std::string& name);
+
+		//Nanoseconds since the trace clock started
+		int64_t GetTimestamp();
+		/**
+		 * \brief Adds a finished event to the calling thread's ring buffer, the oldest events are overwritten once it is full
+		 * \param pName event name, has to outlive the trace (a string literal)
+		 * \param argument shown with the event when not negative, like a tile index
+		 */
+		void Record(const char* pName, int64_t startTime, int64_t endTime, int64_t argument = -1);
+
+		//Dump and clear read every thread's buffer, so they have to be called between frames while no other thread records
+		bool SaveToFile(const std::string& filePath);
+		void Clear();
+	}
+
+	//Records the time between its construction and destruction as one event, if tracing was enabled at construction
+	class TraceScope final
+	{
+	public:
+		explicit TraceScope(const char* pName, int64_t argument = -1) :
+			m_pName{ Trace::IsEnabled() ? pName : nullptr },
+			m_Argument{ argument },
+			m_StartTime{ m_pName ? Trace::GetTimestamp() : 0 }
+		{
+		}
+		~TraceScope()
+		{
+			if (m_pName)
+				Trace::Record(m_pName, m_StartTime, Trace::GetTimestamp(), m_Argument);
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope(TraceScope&&) noexcept = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+		TraceScope& operator=(TraceScope&&) noexcept = delete;
+
+	private:
+		const char* m_pName;
+		int64_t m_Argument;
+		int64_t m_StartTime;
+	};
+}
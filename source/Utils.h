@@ -1,8 +1,10 @@
 #pragma once
 #include <cassert>
-#include <fstream>
+#include <cmath>
 #include "Math.h"
 #include "DataTypes.h"
+#include "SIMD.h"
+#include "Stats.h"
 
 namespace dae
 {
@@ -15,8 +17,8 @@ namespace dae
 			//Analytic solution
 			float A{ Vector3::Dot(ray.direction, ray.direction) };
 			float B{ Vector3::Dot(2 * ray.direction, (ray.origin - sphere.origin)) };
-			float C{ Vector3::Dot(ray.origin - sphere.origin, ray.origin - sphere.origin) - powf(sphere.radius, 2) };
-			float discriminant{ powf(B, 2) - 4 * A * C };
+			float C{ Vector3::Dot(ray.origin - sphere.origin, ray.origin - sphere.origin) - sphere.radius * sphere.radius };
+			float discriminant{ B * B - 4 * A * C };
 
 			if (discriminant > 0)
 			{
@@ -89,6 +91,75 @@ namespace dae
 			HitRecord temp{};
 			return HitTest_Sphere(sphere, ray, temp, true);
 		}
+
+		/**
+		 * \brief Analytic sphere test against a block of spheres, SimdWidth spheres per iteration
+		 * \param spheres spheres in BVH leaf order
+		 * \param first first sphere of the block
+		 * \param count number of spheres in the block, lanes past it are masked out
+		 * \param t in: distance to stay below, out: distance of the closest hit
+		 * \return index in spheres of the closest hit within (ray.min, t), or -1
+		 */
+		inline int HitTest_SphereBlock(const SphereSoA& spheres, uint32_t first, uint32_t count, const Ray& ray, float& t)
+		{
+			RAYTRACER_STAT_ADD(PrimitiveTests, count);
+
+			const float A{ Vector3::Dot(ray.direction, ray.direction) };
+			const SimdFloat originX{ SimdSet(ray.origin.x) }, originY{ SimdSet(ray.origin.y) }, originZ{ SimdSet(ray.origin.z) };
+			const SimdFloat twoDirectionX{ SimdSet(2 * ray.direction.x) }, twoDirectionY{ SimdSet(2 * ray.direction.y) }, twoDirectionZ{ SimdSet(2 * ray.direction.z) };
+			const SimdFloat fourA{ SimdSet(4 * A) }, twoA{ SimdSet(2 * A) };
+			const SimdFloat zero{ SimdSet(0.f) };
+			const SimdFloat rayMin{ SimdSet(ray.min) };
+
+			int closestIndex{ -1 };
+			for (uint32_t offset{ 0 }; offset < count; offset += SimdWidth)
+			{
+				const uint32_t index{ first + offset };
+				const SimdFloat toOriginX{ originX - SimdLoad(spheres.Get(SphereSoA::CenterX) + index) };
+				const SimdFloat toOriginY{ originY - SimdLoad(spheres.Get(SphereSoA::CenterY) + index) };
+				const SimdFloat toOriginZ{ originZ - SimdLoad(spheres.Get(SphereSoA::CenterZ) + index) };
+
+				const SimdFloat B{ twoDirectionX * toOriginX + twoDirectionY * toOriginY + twoDirectionZ * toOriginZ };
+				const SimdFloat C{ toOriginX * toOriginX + toOriginY * toOriginY + toOriginZ * toOriginZ -
+					SimdLoad(spheres.Get(SphereSoA::RadiusSquared) + index) };
+				const SimdFloat discriminant{ B * B - fourA * C };
+
+				SimdFloat valid{ SimdLaneMask(static_cast<int>(count - offset)) & (discriminant > zero) };
+				if (SimdMoveMask(valid) == 0)
+					continue;
+
+				//Nearest root, or the far one when the ray starts inside the sphere
+				const SimdFloat root{ SimdSqrt(SimdMax(discriminant, zero)) };
+				const SimdFloat tNear{ (zero - B - root) / twoA };
+				const SimdFloat tFar{ (zero - B + root) / twoA };
+				const SimdFloat tLanes{ SimdSelect(tNear < rayMin, tFar, tNear) };
+				valid = valid & (tLanes > rayMin) & (tLanes < SimdSet(t));
+
+				int hitMask{ SimdMoveMask(valid) };
+				if (hitMask == 0)
+					continue;
+
+				float laneT[SimdWidth];
+				SimdStore(laneT, tLanes);
+				int closestLane{ -1 };
+				float closestT{ t };
+				while (hitMask != 0)
+				{
+					const int lane{ std::countr_zero(static_cast<unsigned int>(hitMask)) };
+					hitMask &= hitMask - 1;
+					if (laneT[lane] < closestT)
+					{
+						closestT = laneT[lane];
+						closestLane = lane;
+					}
+				}
+
+				t = closestT;
+				closestIndex = static_cast<int>(index) + closestLane;
+			}
+
+			return closestIndex;
+		}
 #pragma endregion
 #pragma region Plane HitTest
 		//PLANE HIT-TESTS
@@ -115,8 +186,8 @@ namespace dae
 
 		inline bool HitTest_Plane(const Plane& plane, const Ray& ray)
 		{
-			HitRecord temp{};
-			return HitTest_Plane(plane, ray, temp, true);
+			const float t{ (Vector3::Dot(plane.origin - ray.origin, plane.normal) / Vector3::Dot(ray.direction, plane.normal)) };
+			return t > ray.min && t < ray.max;
 		}
 #pragma endregion
 #pragma region Triangle HitTest
@@ -261,167 +332,926 @@ namespace dae
 			return HitTest_Triangle(triangle, ray, temp, true);
 		}
 #pragma endregion
-#pragma region TriangeMesh HitTest
-		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+#pragma region BVH Traversal
+		//Returns the distance at which the ray enters the box, or FLT_MAX when it misses the box within [ray.min, ray.max]
+		inline float SlabTest_AABB(const Vector3& minAABB, const Vector3& maxAABB, const Ray& ray, const Vector3& invDirection)
 		{
-			float tx1 = (mesh.transformedMinAABB.x - ray.origin.x) / ray.direction.x;
-			float tx2 = (mesh.transformedMaxAABB.x - ray.origin.x) / ray.direction.x;
+			const float tx1 = (minAABB.x - ray.origin.x) * invDirection.x;
+			const float tx2 = (maxAABB.x - ray.origin.x) * invDirection.x;
 
 			float tmin = std::min(tx1, tx2);
 			float tmax = std::max(tx1, tx2);
 
-			float ty1 = (mesh.transformedMinAABB.y - ray.origin.y) / ray.direction.y;
-			float ty2 = (mesh.transformedMaxAABB.y - ray.origin.y) / ray.direction.y;
+			const float ty1 = (minAABB.y - ray.origin.y) * invDirection.y;
+			const float ty2 = (maxAABB.y - ray.origin.y) * invDirection.y;
 
 			tmin = std::max(tmin, std::min(ty1, ty2));
 			tmax = std::min(tmax, std::max(ty1, ty2));
 
-			float tz1 = (mesh.transformedMinAABB.z - ray.origin.z) / ray.direction.z;
-			float tz2 = (mesh.transformedMaxAABB.z - ray.origin.z) / ray.direction.z;
+			const float tz1 = (minAABB.z - ray.origin.z) * invDirection.z;
+			const float tz2 = (maxAABB.z - ray.origin.z) * invDirection.z;
 
 			tmin = std::max(tmin, std::min(tz1, tz2));
 			tmax = std::min(tmax, std::max(tz1, tz2));
 
-			return tmax > 0 && tmax >= tmin;
+			if (tmax >= tmin && tmax > ray.min && tmin < ray.max)
+				return tmin;
+
+			return FLT_MAX;
 		}
-		
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+
+		//Ray data shared by every wide node test of one traversal
+		//Near and far planes are picked per axis from the direction sign, so inverted (unused) child slots never hit
+		struct BVH4Ray
 		{
-			// slabtest
-			if (!SlabTest_TriangleMesh(mesh, ray))
+			BVH4Ray(const Ray& ray)
 			{
-				return false;
+				const Vector3 invDirection{ 1.f / ray.direction.x, 1.f / ray.direction.y, 1.f / ray.direction.z };
+				for (int axis{ 0 }; axis < 3; ++axis)
+				{
+					origin[axis] = ray.origin[axis];
+					invDir[axis] = invDirection[axis];
+					nearPlane[axis] = invDirection[axis] >= 0.f ? axis : axis + 3;
+					farPlane[axis] = invDirection[axis] >= 0.f ? axis + 3 : axis;
+				}
 			}
 
-			HitRecord hitRecordTestHit{};
-			//hitRecordClosestHit.t = ray.max;
-			int triangleAmount{ int(mesh.indices.size()) / 3 };
+			float origin[3]{};
+			float invDir[3]{};
+			int nearPlane[3]{};
+			int farPlane[3]{};
+		};
 
-			for (int i{}; i < triangleAmount; ++i)
+		//Tests the ray against all four children of a wide node at once
+		//Returns a bit per child that is hit within [rayMin, rayMax] and writes the entry distance of every child
+		inline int SlabTest_BVH4Node(const BVH4Node& node, const BVH4Ray& ray, float rayMin, float rayMax, float tEntry[4])
+		{
+#if defined(RAYTRACER_SSE)
+			__m128 tNear{ _mm_set1_ps(rayMin) };
+			__m128 tFar{ _mm_set1_ps(rayMax) };
+			for (int axis{ 0 }; axis < 3; ++axis)
 			{
-				int index1{ i * 3 }, index2{ i * 3 + 1 }, index3{ i * 3 + 2 };
-				
-				int v0{ mesh.indices[index1] };
-				int v1{ mesh.indices[index2] };
-				int v2{ mesh.indices[index3] };
+				const __m128 origin{ _mm_set1_ps(ray.origin[axis]) };
+				const __m128 invDir{ _mm_set1_ps(ray.invDir[axis]) };
+				tNear = _mm_max_ps(tNear, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[ray.nearPlane[axis]]), origin), invDir));
+				tFar = _mm_min_ps(tFar, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[ray.farPlane[axis]]), origin), invDir));
+			}
 
-				Triangle triangle(mesh.transformedPositions[v0], mesh.transformedPositions[v1], mesh.transformedPositions[v2], mesh.transformedNormals[i]);
-				triangle.materialIndex = mesh.materialIndex;
-				triangle.cullMode = mesh.cullMode;
-				HitTest_Triangle(triangle, ray, hitRecordTestHit);
-				if (hitRecordTestHit.t < hitRecord.t)
+			_mm_storeu_ps(tEntry, tNear);
+			return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+#else
+			int hitMask{ 0 };
+			for (int lane{ 0 }; lane < 4; ++lane)
+			{
+				float tNear{ rayMin }, tFar{ rayMax };
+				for (int axis{ 0 }; axis < 3; ++axis)
 				{
-					hitRecord = hitRecordTestHit;
+					tNear = std::max(tNear, (node.bounds[ray.nearPlane[axis]][lane] - ray.origin[axis]) * ray.invDir[axis]);
+					tFar = std::min(tFar, (node.bounds[ray.farPlane[axis]][lane] - ray.origin[axis]) * ray.invDir[axis]);
 				}
+
+				tEntry[lane] = tNear;
+				if (tNear <= tFar)
+					hitMask |= 1 << lane;
 			}
-			if (hitRecordTestHit.didHit)
+			return hitMask;
+#endif
+		}
+
+		/**
+		 * \brief Walks the BVH front-to-back and calls intersectLeaf for every leaf the ray reaches
+		 * \param bvh hierarchy to traverse, through its 4-wide nodes
+		 * \param ray ray to trace, intersectLeaf shrinks ray.max on a hit so nodes behind it are skipped
+		 * \param intersectLeaf bool(uint32_t first, uint32_t count, Ray& ray) for the entries [first, first + count)
+		 * of the primitive index list, returning true stops the traversal
+		 * \return true when intersectLeaf stopped the traversal
+		 */
+		template<typename IntersectFunc>
+		inline bool TraverseBVHLeaves(const BVH& bvh, Ray& ray, IntersectFunc&& intersectLeaf)
+		{
+			const std::span<const BVH4Node> nodes{ bvh.GetWideNodes() };
+			if (nodes.empty())
 			{
-				return true;
+				return false;
 			}
-			else
+
+			const BVH4Ray wideRay{ ray };
+
+			//Stack entries are children (interior or leaf) with their entry distance, so anything behind the closest hit is skipped when popped
+			struct StackEntry
 			{
-				return false;
+				uint32_t child;
+				uint32_t primitiveCount;
+				float tEntry;
+			};
+			StackEntry stack[BVH::MaxDepth * 3 + 1]{};
+			uint32_t stackSize{ 0 };
+			stack[stackSize++] = { 0, 0, ray.min };
+
+			while (stackSize > 0)
+			{
+				const StackEntry entry{ stack[--stackSize] };
+				if (entry.tEntry > ray.max)
+				{
+					continue;
+				}
+
+				if (entry.primitiveCount > 0)
+				{
+					if (intersectLeaf(entry.child, entry.primitiveCount, ray))
+					{
+						return true;
+					}
+					continue;
+				}
+
+				const BVH4Node& node = nodes[entry.child];
+				RAYTRACER_STAT_INC(NodeVisits);
+				float tEntry[4];
+				const int hitMask{ SlabTest_BVH4Node(node, wideRay, ray.min, ray.max, tEntry) };
+				if (hitMask == 0)
+				{
+					continue;
+				}
+
+				//Sort the hit children far to near, then push them so the nearest is popped first
+				int order[4];
+				int hitCount{ 0 };
+				for (int lane{ 0 }; lane < 4; ++lane)
+				{
+					if (!(hitMask & (1 << lane)))
+						continue;
+
+					int insert{ hitCount++ };
+					while (insert > 0 && tEntry[order[insert - 1]] < tEntry[lane])
+					{
+						order[insert] = order[insert - 1];
+						--insert;
+					}
+					order[insert] = lane;
+				}
+
+				for (int i{ 0 }; i < hitCount; ++i)
+				{
+					const int lane{ order[i] };
+					stack[stackSize++] = { node.child[lane], node.primitiveCount[lane], tEntry[lane] };
+				}
 			}
+
+			return false;
 		}
 
-		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		/**
+		 * \brief Walks the BVH front-to-back and calls intersectPrimitive for every primitive in a leaf the ray reaches
+		 * \param bvh hierarchy to traverse, through its 4-wide nodes
+		 * \param ray ray to trace, intersectPrimitive shrinks ray.max on a hit so nodes behind it are skipped
+		 * \param intersectPrimitive bool(uint32_t primitiveIndex, Ray& ray), returning true stops the traversal
+		 * \return true when intersectPrimitive stopped the traversal
+		 */
+		template<typename IntersectFunc>
+		inline bool TraverseBVH(const BVH& bvh, Ray& ray, IntersectFunc&& intersectPrimitive)
 		{
-			HitRecord temp{};
-			return HitTest_TriangleMesh(mesh, ray, temp, true);
+			const std::span<const uint32_t> primitiveIndices{ bvh.GetPrimitiveIndices() };
+			return TraverseBVHLeaves(bvh, ray, [&](uint32_t first, uint32_t count, Ray& testRay)
+				{
+					for (uint32_t i{ 0 }; i < count; ++i)
+					{
+						if (intersectPrimitive(primitiveIndices[first + i], testRay))
+						{
+							return true;
+						}
+					}
+					return false;
+				});
+		}
+
+		/**
+		 * \brief Any-hit traversal for occlusion queries, stops as soon as intersectLeaf reports a hit
+		 * There is no closest hit to shrink the ray, so children are not sorted by distance.
+		 * Leaf children are tested as soon as their node is, a hit there ends the query without descending further.
+		 * \param intersectLeaf bool(uint32_t first, uint32_t count) for the entries [first, first + count) of the primitive index list
+		 * \return true when intersectLeaf found a hit
+		 */
+		template<typename IntersectFunc>
+		inline bool TraverseBVHLeavesOcclusion(const BVH& bvh, const Ray& ray, IntersectFunc&& intersectLeaf)
+		{
+			const std::span<const BVH4Node> nodes{ bvh.GetWideNodes() };
+			if (nodes.empty())
+			{
+				return false;
+			}
+
+			const BVH4Ray wideRay{ ray };
+
+			uint32_t stack[BVH::MaxDepth * 3 + 1]{};
+			uint32_t stackSize{ 0 };
+			stack[stackSize++] = 0;
+
+			while (stackSize > 0)
+			{
+				const BVH4Node& node = nodes[stack[--stackSize]];
+				RAYTRACER_STAT_INC(NodeVisits);
+				float tEntry[4];
+				const int hitMask{ SlabTest_BVH4Node(node, wideRay, ray.min, ray.max, tEntry) };
+
+				for (int lane{ 0 }; lane < 4; ++lane)
+				{
+					if (!(hitMask & (1 << lane)))
+						continue;
+
+					if (node.primitiveCount[lane] == 0)
+					{
+						stack[stackSize++] = node.child[lane];
+					}
+					else if (intersectLeaf(node.child[lane], node.primitiveCount[lane]))
+					{
+						return true;
+					}
+				}
+			}
+
+			return false;
 		}
 #pragma endregion
-	}
+#pragma region Ray Packet Traversal
+		//Bounds of the origins and inverse directions of the selected rays of a packet
+		//Interval culling is only valid when every ray points the same way on each axis, otherwise isCoherent is false
+		struct PacketInterval
+		{
+			PacketInterval(const RayPacket& packet, uint64_t rayMask)
+			{
+				const float* origins[3]{ packet.originX, packet.originY, packet.originZ };
+				const float* invDirections[3]{ packet.invDirectionX, packet.invDirectionY, packet.invDirectionZ };
 
-	namespace LightUtils
-	{
-		//Direction from target to light
-		inline Vector3 GetDirectionToLight(const Light& light, const Vector3 origin)
+				for (int axis{ 0 }; axis < 3; ++axis)
+				{
+					originMin[axis] = invDirMin[axis] = FLT_MAX;
+					originMax[axis] = invDirMax[axis] = -FLT_MAX;
+				}
+
+				for (uint64_t mask{ rayMask }; mask != 0; mask &= mask - 1)
+				{
+					const int index{ std::countr_zero(mask) };
+					for (int axis{ 0 }; axis < 3; ++axis)
+					{
+						originMin[axis] = std::min(originMin[axis], origins[axis][index]);
+						originMax[axis] = std::max(originMax[axis], origins[axis][index]);
+						invDirMin[axis] = std::min(invDirMin[axis], invDirections[axis][index]);
+						invDirMax[axis] = std::max(invDirMax[axis], invDirections[axis][index]);
+					}
+					rayMin = std::min(rayMin, packet.min[index]);
+					rayMax = std::max(rayMax, packet.max[index]);
+				}
+
+				isCoherent = rayMask != 0;
+				for (int axis{ 0 }; axis < 3; ++axis)
+				{
+					isCoherent = isCoherent && (invDirMin[axis] >= 0.f || invDirMax[axis] < 0.f);
+					nearPlane[axis] = invDirMin[axis] >= 0.f ? axis : axis + 3;
+					farPlane[axis] = invDirMin[axis] >= 0.f ? axis + 3 : axis;
+				}
+			}
+
+			float originMin[3]{}, originMax[3]{};
+			float invDirMin[3]{}, invDirMax[3]{};
+			float rayMin{ FLT_MAX }, rayMax{ -FLT_MAX };
+			int nearPlane[3]{}, farPlane[3]{};
+			bool isCoherent{};
+		};
+
+		//Culls the four children of a wide node for a whole packet with interval arithmetic
+		//Returns a bit per child that some ray of the interval may hit, tEntry receives a lower bound of the entry distance
+		inline int IntervalTest_BVH4Node(const BVH4Node& node, const PacketInterval& interval, float rayMin, float rayMax, float tEntry[4])
 		{
-			Vector3 DirectionToLight{light.origin - origin};
-			return DirectionToLight;
+#if defined(RAYTRACER_SSE)
+			__m128 tNear{ _mm_set1_ps(rayMin) };
+			__m128 tFar{ _mm_set1_ps(rayMax) };
+			for (int axis{ 0 }; axis < 3; ++axis)
+			{
+				const __m128 originMin{ _mm_set1_ps(interval.originMin[axis]) };
+				const __m128 originMax{ _mm_set1_ps(interval.originMax[axis]) };
+				const __m128 invDirMin{ _mm_set1_ps(interval.invDirMin[axis]) };
+				const __m128 invDirMax{ _mm_set1_ps(interval.invDirMax[axis]) };
+
+				//(plane - [originMin, originMax]) * [invDirMin, invDirMax], lowest bound for the near plane, highest for the far plane
+				const __m128 nearPlane{ _mm_load_ps(node.bounds[interval.nearPlane[axis]]) };
+				const __m128 nearA{ _mm_sub_ps(nearPlane, originMax) }, nearB{ _mm_sub_ps(nearPlane, originMin) };
+				tNear = _mm_max_ps(tNear, _mm_min_ps(
+					_mm_min_ps(_mm_mul_ps(nearA, invDirMin), _mm_mul_ps(nearA, invDirMax)),
+					_mm_min_ps(_mm_mul_ps(nearB, invDirMin), _mm_mul_ps(nearB, invDirMax))));
+
+				const __m128 farPlane{ _mm_load_ps(node.bounds[interval.farPlane[axis]]) };
+				const __m128 farA{ _mm_sub_ps(farPlane, originMax) }, farB{ _mm_sub_ps(farPlane, originMin) };
+				tFar = _mm_min_ps(tFar, _mm_max_ps(
+					_mm_max_ps(_mm_mul_ps(farA, invDirMin), _mm_mul_ps(farA, invDirMax)),
+					_mm_max_ps(_mm_mul_ps(farB, invDirMin), _mm_mul_ps(farB, invDirMax))));
+			}
+
+			_mm_storeu_ps(tEntry, tNear);
+			return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+#else
+			int hitMask{ 0 };
+			for (int lane{ 0 }; lane < 4; ++lane)
+			{
+				float tNear{ rayMin }, tFar{ rayMax };
+				for (int axis{ 0 }; axis < 3; ++axis)
+				{
+					const float nearA{ node.bounds[interval.nearPlane[axis]][lane] - interval.originMax[axis] };
+					const float nearB{ node.bounds[interval.nearPlane[axis]][lane] - interval.originMin[axis] };
+					tNear = std::max(tNear, std::min({ nearA * interval.invDirMin[axis], nearA * interval.invDirMax[axis],
+						nearB * interval.invDirMin[axis], nearB * interval.invDirMax[axis] }));
+
+					const float farA{ node.bounds[interval.farPlane[axis]][lane] - interval.originMax[axis] };
+					const float farB{ node.bounds[interval.farPlane[axis]][lane] - interval.originMin[axis] };
+					tFar = std::min(tFar, std::max({ farA * interval.invDirMin[axis], farA * interval.invDirMax[axis],
+						farB * interval.invDirMin[axis], farB * interval.invDirMax[axis] }));
+				}
+
+				tEntry[lane] = tNear;
+				if (tNear <= tFar)
+					hitMask |= 1 << lane;
+			}
+			return hitMask;
+#endif
 		}
 
-		inline ColorRGB GetRadiance(const Light& light, const Vector3& target)
+		//Tests the selected rays of a packet against one child box of a wide node, SimdWidth rays at a time
+		//Returns the mask of rays that hit the box within their own [min, max]
+		inline uint64_t SlabTest_Packet(const BVH4Node& node, int lane, const RayPacket& packet, uint64_t rayMask)
 		{
-			Vector3 vectorFromTargetToLight{ light.origin - target };
-			float radius{ vectorFromTargetToLight.SqrMagnitude() };
+			const float* origins[3]{ packet.originX, packet.originY, packet.originZ };
+			const float* invDirections[3]{ packet.invDirectionX, packet.invDirectionY, packet.invDirectionZ };
+			constexpr uint64_t groupMask{ (uint64_t{ 1 } << SimdWidth) - 1 };
 
-			return light.color * (light.intensity / radius);
+			uint64_t hitMask{ 0 };
+			for (uint32_t offset{ 0 }; offset < packet.size; offset += SimdWidth)
+			{
+				if (((rayMask >> offset) & groupMask) == 0)
+					continue;
+
+				SimdFloat tNear{ SimdLoad(packet.min + offset) };
+				SimdFloat tFar{ SimdLoad(packet.max + offset) };
+				for (int axis{ 0 }; axis < 3; ++axis)
+				{
+					const SimdFloat origin{ SimdLoad(origins[axis] + offset) };
+					const SimdFloat invDirection{ SimdLoad(invDirections[axis] + offset) };
+					const SimdFloat t1{ (SimdSet(node.bounds[axis][lane]) - origin) * invDirection };
+					const SimdFloat t2{ (SimdSet(node.bounds[axis + 3][lane]) - origin) * invDirection };
+					tNear = SimdMax(tNear, SimdMin(t1, t2));
+					tFar = SimdMin(tFar, SimdMax(t1, t2));
+				}
+
+				hitMask |= static_cast<uint64_t>(SimdMoveMask(tNear <= tFar)) << offset;
+			}
+
+			return hitMask & rayMask;
 		}
-	}
 
-	namespace Utils
-	{
-		//Just parses vertices and indices
-#pragma warning(push)
-#pragma warning(disable : 4505) //Warning unreferenced local function
-		static bool ParseOBJ(const std::string& filename, std::vector<Vector3>& positions, std::vector<Vector3>& normals, std::vector<int>& indices)
+		/**
+		 * \brief Walks the BVH with a whole packet and calls intersectLeaf for every leaf with the rays that reach it
+		 * Interior nodes are culled for the whole packet with interval arithmetic, leaves get an exact mask per ray.
+		 * A packet whose directions diverge in sign on some axis falls back to tracing its rays one at a time.
+		 * \param bvh hierarchy to traverse, through its 4-wide nodes
+		 * \param packet rays to trace, intersectLeaf shrinks packet.max of the rays it hits
+		 * \param rayMask rays of the packet to trace
+		 * \param intersectLeaf void(uint32_t first, uint32_t count, uint64_t rayMask) for the entries [first, first + count)
+		 * of the primitive index list
+		 */
+		template<typename IntersectFunc>
+		inline void TraversePacketBVHLeaves(const BVH& bvh, RayPacket& packet, uint64_t rayMask, IntersectFunc&& intersectLeaf)
 		{
-			std::ifstream file(filename);
-			if (!file)
-				return false;
+			const std::span<const BVH4Node> nodes{ bvh.GetWideNodes() };
+			if (nodes.empty() || rayMask == 0)
+			{
+				return;
+			}
+
+			const PacketInterval interval{ packet, rayMask };
+			if (!interval.isCoherent)
+			{
+				for (uint64_t mask{ rayMask }; mask != 0; mask &= mask - 1)
+				{
+					const int index{ std::countr_zero(mask) };
+					Ray ray{ packet.GetRay(index) };
+					TraverseBVHLeaves(bvh, ray, [&](uint32_t first, uint32_t count, Ray& testRay)
+						{
+							intersectLeaf(first, count, uint64_t{ 1 } << index);
+							testRay.max = packet.max[index];
+							return false;
+						});
+				}
+				return;
+			}
+
+			//Leaves keep the wide node and lane they came from, so their box is tested per ray when popped
+			struct StackEntry
+			{
+				uint32_t child;
+				uint32_t primitiveCount;
+				float tEntry;
+				uint32_t parent;
+				int lane;
+			};
+			StackEntry stack[BVH::MaxDepth * 3 + 1]{};
+			uint32_t stackSize{ 0 };
+			stack[stackSize++] = { 0, 0, interval.rayMin, 0, 0 };
+
+			//Furthest distance any selected ray can still hit something at
+			float packetMax{ interval.rayMax };
 
-			std::string sCommand;
-			// start a while iteration ending when the end of file is reached (ios::eof)
-			while (!file.eof())
+			while (stackSize > 0)
 			{
-				//read the first word of the string, use the >> operator (istream::operator>>) 
-				file >> sCommand;
-				//use conditional statements to process the different commands	
-				if (sCommand == "#")
+				const StackEntry entry{ stack[--stackSize] };
+				if (entry.tEntry > packetMax)
 				{
-					// Ignore Comment
+					continue;
 				}
-				else if (sCommand == "v")
+
+				if (entry.primitiveCount > 0)
 				{
-					//Vertex
-					float x, y, z;
-					file >> x >> y >> z;
-					positions.push_back({ x, y, z });
+					const uint64_t leafMask{ SlabTest_Packet(nodes[entry.parent], entry.lane, packet, rayMask) };
+					if (leafMask == 0)
+					{
+						continue;
+					}
+
+					intersectLeaf(entry.child, entry.primitiveCount, leafMask);
+
+					packetMax = -FLT_MAX;
+					for (uint64_t mask{ rayMask }; mask != 0; mask &= mask - 1)
+					{
+						packetMax = std::max(packetMax, packet.max[std::countr_zero(mask)]);
+					}
+					continue;
+				}
+
+				const BVH4Node& node = nodes[entry.child];
+				RAYTRACER_STAT_INC(NodeVisits);
+				float tEntry[4];
+				const int hitMask{ IntervalTest_BVH4Node(node, interval, interval.rayMin, packetMax, tEntry) };
+				if (hitMask == 0)
+				{
+					continue;
 				}
-				else if (sCommand == "f")
+
+				//Sort the hit children far to near, then push them so the nearest is popped first
+				int order[4];
+				int hitCount{ 0 };
+				for (int lane{ 0 }; lane < 4; ++lane)
 				{
-					float i0, i1, i2;
-					file >> i0 >> i1 >> i2;
+					if (!(hitMask & (1 << lane)))
+						continue;
+
+					int insert{ hitCount++ };
+					while (insert > 0 && tEntry[order[insert - 1]] < tEntry[lane])
+					{
+						order[insert] = order[insert - 1];
+						--insert;
+					}
+					order[insert] = lane;
+				}
 
-					indices.push_back((int)i0 - 1);
-					indices.push_back((int)i1 - 1);
-					indices.push_back((int)i2 - 1);
+				for (int i{ 0 }; i < hitCount; ++i)
+				{
+					const int lane{ order[i] };
+					stack[stackSize++] = { node.child[lane], node.primitiveCount[lane], tEntry[lane], entry.child, lane };
 				}
-				//read till end of line and ignore all remaining chars
-				file.ignore(1000, '\n');
+			}
+		}
+#pragma endregion
+#pragma region Spheres HitTest
+		inline void FillSphereHitRecord(const SphereSoA& spheres, int index, const Ray& ray, float t, HitRecord& hitRecord)
+		{
+			const Vector3 center{ spheres.Get(SphereSoA::CenterX)[index], spheres.Get(SphereSoA::CenterY)[index], spheres.Get(SphereSoA::CenterZ)[index] };
+			hitRecord.didHit = true;
+			hitRecord.materialIndex = spheres.materialIndices[index];
+			hitRecord.origin = ray.origin + t * ray.direction;
+			hitRecord.t = t;
+			hitRecord.normal = (hitRecord.origin - center).Normalized();
+		}
+
+		//Closest hit against the sphere blocks in the leaves of a BVH
+		inline bool HitTest_Spheres(const BVH& bvh, const SphereSoA& spheres, const Ray& ray, HitRecord& hitRecord)
+		{
+			Ray closestRay{ ray };
+			int closestIndex{ -1 };
+
+			TraverseBVHLeaves(bvh, closestRay, [&](uint32_t first, uint32_t count, Ray& testRay)
+				{
+					float t{ testRay.max };
+					const int index{ HitTest_SphereBlock(spheres, first, count, testRay, t) };
+					if (index >= 0)
+					{
+						testRay.max = t;
+						closestIndex = index;
+					}
+					return false;
+				});
+
+			if (closestIndex < 0)
+			{
+				return false;
+			}
+
+			FillSphereHitRecord(spheres, closestIndex, ray, closestRay.max, hitRecord);
+			return true;
+		}
+
+		//Any hit against the sphere blocks in the leaves of a BVH, stops at the first block with a hit
+		inline bool HitTest_Spheres(const BVH& bvh, const SphereSoA& spheres, const Ray& ray)
+		{
+			return TraverseBVHLeavesOcclusion(bvh, ray, [&](uint32_t first, uint32_t count)
+				{
+					float t{ ray.max };
+					return HitTest_SphereBlock(spheres, first, count, ray, t) >= 0;
+				});
+		}
+
+		//Closest hits of the selected rays of a packet, rays that hit get their packet.max shrunk and their hit record written
+		inline uint64_t HitTest_SpheresPacket(const BVH& bvh, const SphereSoA& spheres, RayPacket& packet, uint64_t rayMask, HitRecord* hitRecords)
+		{
+			int closestIndices[RayPacket::MaxSize];
+			uint64_t hitMask{ 0 };
+
+			TraversePacketBVHLeaves(bvh, packet, rayMask, [&](uint32_t first, uint32_t count, uint64_t leafMask)
+				{
+					for (uint64_t mask{ leafMask }; mask != 0; mask &= mask - 1)
+					{
+						const int rayIndex{ std::countr_zero(mask) };
+						const Ray ray{ packet.GetRay(rayIndex) };
+						float t{ ray.max };
+						const int index{ HitTest_SphereBlock(spheres, first, count, ray, t) };
+						if (index >= 0)
+						{
+							packet.max[rayIndex] = t;
+							closestIndices[rayIndex] = index;
+							hitMask |= uint64_t{ 1 } << rayIndex;
+						}
+					}
+				});
+
+			for (uint64_t mask{ hitMask }; mask != 0; mask &= mask - 1)
+			{
+				const int rayIndex{ std::countr_zero(mask) };
+				const Ray ray{ packet.GetRay(rayIndex) };
+				FillSphereHitRecord(spheres, closestIndices[rayIndex], ray, ray.max, hitRecords[rayIndex]);
+			}
+			return hitMask;
+		}
+#pragma endregion
+#pragma region TriangeMesh HitTest
+		inline bool SlabTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		{
+			float tx1 = (mesh.transformedMinAABB.x - ray.origin.x) / ray.direction.x;
+			float tx2 = (mesh.transformedMaxAABB.x - ray.origin.x) / ray.direction.x;
+
+			float tmin = std::min(tx1, tx2);
+			float tmax = std::max(tx1, tx2);
+
+			float ty1 = (mesh.transformedMinAABB.y - ray.origin.y) / ray.direction.y;
+			float ty2 = (mesh.transformedMaxAABB.y - ray.origin.y) / ray.direction.y;
+
+			tmin = std::max(tmin, std::min(ty1, ty2));
+			tmax = std::min(tmax, std::max(ty1, ty2));
+
+			float tz1 = (mesh.transformedMinAABB.z - ray.origin.z) / ray.direction.z;
+			float tz2 = (mesh.transformedMaxAABB.z - ray.origin.z) / ray.direction.z;
+
+			tmin = std::max(tmin, std::min(tz1, tz2));
+			tmax = std::min(tmax, std::max(tz1, tz2));
 
-				if (file.eof()) 
-					break;
+			return tmax > 0 && tmax >= tmin;
+		}
+		
+		//Ray data shared by every triangle block test of one ray
+		struct TriangleBlockRay
+		{
+			TriangleBlockRay(const Ray& ray) :
+				originX{ SimdSet(ray.origin.x) }, originY{ SimdSet(ray.origin.y) }, originZ{ SimdSet(ray.origin.z) },
+				directionX{ SimdSet(ray.direction.x) }, directionY{ SimdSet(ray.direction.y) }, directionZ{ SimdSet(ray.direction.z) },
+				rayMin{ SimdSet(ray.min) }
+			{
 			}
 
-			//Precompute normals
-			for (uint64_t index = 0; index < indices.size(); index += 3)
+			SimdFloat originX, originY, originZ;
+			SimdFloat directionX, directionY, directionZ;
+			SimdFloat rayMin;
+		};
+
+		/**
+		 * \brief Mller-Trumbore against SimdWidth triangles starting at index
+		 * Culling follows HitTest_Triangle for camera rays: the sign of dot(normal, direction) decides per cull mode
+		 * \param laneCount number of triangles to test, lanes past it are masked out
+		 * \param tMax furthest distance to accept
+		 * \param tLanes receives the distance of every lane
+		 * \return one bit per lane that hits within [ray.min, tMax]
+		 */
+		inline int IntersectTriangleLanes(const TriangleSoA& triangles, uint32_t index, int laneCount, TriangleCullMode cullMode,
+			const TriangleBlockRay& ray, float tMax, SimdFloat& tLanes)
+		{
+			const SimdFloat zero{ SimdSet(0.f) }, one{ SimdSet(1.f) };
+			const SimdFloat epsilon{ SimdSet(0.0000001f) }, negativeEpsilon{ SimdSet(-0.0000001f) };
+
+			const SimdFloat v0X{ SimdLoad(triangles.Get(TriangleSoA::V0X) + index) };
+			const SimdFloat v0Y{ SimdLoad(triangles.Get(TriangleSoA::V0Y) + index) };
+			const SimdFloat v0Z{ SimdLoad(triangles.Get(TriangleSoA::V0Z) + index) };
+			const SimdFloat edge1X{ SimdLoad(triangles.Get(TriangleSoA::Edge1X) + index) };
+			const SimdFloat edge1Y{ SimdLoad(triangles.Get(TriangleSoA::Edge1Y) + index) };
+			const SimdFloat edge1Z{ SimdLoad(triangles.Get(TriangleSoA::Edge1Z) + index) };
+			const SimdFloat edge2X{ SimdLoad(triangles.Get(TriangleSoA::Edge2X) + index) };
+			const SimdFloat edge2Y{ SimdLoad(triangles.Get(TriangleSoA::Edge2Y) + index) };
+			const SimdFloat edge2Z{ SimdLoad(triangles.Get(TriangleSoA::Edge2Z) + index) };
+
+			SimdFloat valid{ SimdLaneMask(laneCount) };
+
+			//Culling
+			if (cullMode != TriangleCullMode::NoCulling)
 			{
-				uint32_t i0 = indices[index];
-				uint32_t i1 = indices[index + 1];
-				uint32_t i2 = indices[index + 2];
+				const SimdFloat normalDotDirection{
+					SimdLoad(triangles.Get(TriangleSoA::NormalX) + index) * ray.directionX +
+					SimdLoad(triangles.Get(TriangleSoA::NormalY) + index) * ray.directionY +
+					SimdLoad(triangles.Get(TriangleSoA::NormalZ) + index) * ray.directionZ };
+				valid = valid & (cullMode == TriangleCullMode::BackFaceCulling ? normalDotDirection <= zero : normalDotDirection >= zero);
+			}
+
+			//h = direction x edge2, a = edge1 . h
+			const SimdFloat hX{ ray.directionY * edge2Z - ray.directionZ * edge2Y };
+			const SimdFloat hY{ ray.directionZ * edge2X - ray.directionX * edge2Z };
+			const SimdFloat hZ{ ray.directionX * edge2Y - ray.directionY * edge2X };
+			const SimdFloat a{ edge1X * hX + edge1Y * hY + edge1Z * hZ };
+			//Ray is parallel with triangle
+			valid = valid & ((a <= negativeEpsilon) | (a >= epsilon));
+
+			const SimdFloat f{ one / a };
+			const SimdFloat sX{ ray.originX - v0X }, sY{ ray.originY - v0Y }, sZ{ ray.originZ - v0Z };
+			const SimdFloat u{ f * (sX * hX + sY * hY + sZ * hZ) };
+			valid = valid & (u >= zero) & (u <= one);
+
+			//q = s x edge1
+			const SimdFloat qX{ sY * edge1Z - sZ * edge1Y };
+			const SimdFloat qY{ sZ * edge1X - sX * edge1Z };
+			const SimdFloat qZ{ sX * edge1Y - sY * edge1X };
+			const SimdFloat v{ f * (ray.directionX * qX + ray.directionY * qY + ray.directionZ * qZ) };
+			valid = valid & (v >= zero) & (u + v <= one);
+
+			tLanes = f * (edge2X * qX + edge2Y * qY + edge2Z * qZ);
+			valid = valid & (tLanes >= ray.rayMin) & (tLanes <= SimdSet(tMax)) & (tLanes > epsilon);
 
-				Vector3 edgeV0V1 = positions[i1] - positions[i0];
-				Vector3 edgeV0V2 = positions[i2] - positions[i0];
-				Vector3 normal = Vector3::Cross(edgeV0V1, edgeV0V2);
+			return SimdMoveMask(valid);
+		}
+
+		/**
+		 * \brief Closest hit in a block of triangles, SimdWidth triangles per iteration
+		 * \param triangles triangles in BVH leaf order
+		 * \param first first triangle of the block
+		 * \param count number of triangles in the block
+		 * \param t in: furthest distance to accept, out: distance of the closest hit
+		 * \return index in triangles of the closest hit within [ray.min, t], or -1
+		 */
+		inline int HitTest_TriangleBlock(const TriangleSoA& triangles, uint32_t first, uint32_t count, TriangleCullMode cullMode,
+			const Ray& ray, float& t)
+		{
+			RAYTRACER_STAT_ADD(PrimitiveTests, count);
+			const TriangleBlockRay blockRay{ ray };
+
+			int closestIndex{ -1 };
+			for (uint32_t offset{ 0 }; offset < count; offset += SimdWidth)
+			{
+				const uint32_t index{ first + offset };
+				SimdFloat tLanes;
+				int hitMask{ IntersectTriangleLanes(triangles, index, static_cast<int>(count - offset), cullMode, blockRay, t, tLanes) };
+				if (hitMask == 0)
+					continue;
 
-				if(isnan(normal.x))
+				//Closest lane, on equal distances the later triangle wins like it did when testing one triangle at a time
+				float laneT[SimdWidth];
+				SimdStore(laneT, tLanes);
+				int closestLane{ -1 };
+				float closestT{ t };
+				while (hitMask != 0)
 				{
-					int k = 0;
+					const int lane{ std::countr_zero(static_cast<unsigned int>(hitMask)) };
+					hitMask &= hitMask - 1;
+					if (laneT[lane] <= closestT)
+					{
+						closestT = laneT[lane];
+						closestLane = lane;
+					}
 				}
 
-				normal.Normalize();
-				if (isnan(normal.x))
+				t = closestT;
+				closestIndex = static_cast<int>(index) + closestLane;
+			}
+
+			return closestIndex;
+		}
+
+		//Any hit in a block of triangles, returns as soon as one lane hits within [ray.min, ray.max]
+		inline bool HitTest_TriangleBlock(const TriangleSoA& triangles, uint32_t first, uint32_t count, TriangleCullMode cullMode, const Ray& ray)
+		{
+			RAYTRACER_STAT_ADD(PrimitiveTests, count);
+			const TriangleBlockRay blockRay{ ray };
+			for (uint32_t offset{ 0 }; offset < count; offset += SimdWidth)
+			{
+				SimdFloat tLanes;
+				if (IntersectTriangleLanes(triangles, first + offset, static_cast<int>(count - offset), cullMode, blockRay, ray.max, tLanes) != 0)
+					return true;
+			}
+			return false;
+		}
+
+		//Closest hit against the triangle blocks in the leaves of a BVH, shared by meshes and mesh instances
+		inline bool HitTest_Triangles(const BVH& bvh, const TriangleSoA& triangles, TriangleCullMode cullMode, unsigned char materialIndex,
+			const Ray& ray, HitRecord& hitRecord)
+		{
+			//Every hit shrinks the ray, so only closer triangles are accepted from then on
+			Ray closestRay{ ray };
+			int closestIndex{ -1 };
+
+			TraverseBVHLeaves(bvh, closestRay, [&](uint32_t first, uint32_t count, Ray& testRay)
 				{
-					int k = 0;
-				}
+					float t{ testRay.max };
+					const int index{ HitTest_TriangleBlock(triangles, first, count, cullMode, testRay, t) };
+					if (index >= 0)
+					{
+						testRay.max = t;
+						closestIndex = index;
+					}
+					return false;
+				});
 
-				normals.push_back(normal);
+			if (closestIndex < 0)
+			{
+				return false;
 			}
 
+			hitRecord.didHit = true;
+			hitRecord.materialIndex = materialIndex;
+			hitRecord.t = closestRay.max;
+			hitRecord.origin = ray.origin + ray.direction * hitRecord.t;
+			hitRecord.normal = Vector3{
+				triangles.Get(TriangleSoA::NormalX)[closestIndex],
+				triangles.Get(TriangleSoA::NormalY)[closestIndex],
+				triangles.Get(TriangleSoA::NormalZ)[closestIndex] };
 			return true;
 		}
-#pragma warning(pop)
+
+		//Any hit against the triangle blocks in the leaves of a BVH, stops at the first triangle that hits
+		inline bool HitTest_Triangles(const BVH& bvh, const TriangleSoA& triangles, TriangleCullMode cullMode, const Ray& ray)
+		{
+			return TraverseBVHLeavesOcclusion(bvh, ray, [&](uint32_t first, uint32_t count)
+				{
+					return HitTest_TriangleBlock(triangles, first, count, cullMode, ray);
+				});
+		}
+
+		//Closest hits of the selected rays of a packet against the triangle blocks of a BVH
+		//Rays that hit get their packet.max shrunk and their hit record written, returns the mask of those rays
+		inline uint64_t HitTest_TrianglesPacket(const BVH& bvh, const TriangleSoA& triangles, TriangleCullMode cullMode, unsigned char materialIndex,
+			RayPacket& packet, uint64_t rayMask, HitRecord* hitRecords)
+		{
+			int closestIndices[RayPacket::MaxSize];
+			uint64_t hitMask{ 0 };
+
+			TraversePacketBVHLeaves(bvh, packet, rayMask, [&](uint32_t first, uint32_t count, uint64_t leafMask)
+				{
+					for (uint64_t mask{ leafMask }; mask != 0; mask &= mask - 1)
+					{
+						const int rayIndex{ std::countr_zero(mask) };
+						const Ray ray{ packet.GetRay(rayIndex) };
+						float t{ ray.max };
+						const int index{ HitTest_TriangleBlock(triangles, first, count, cullMode, ray, t) };
+						if (index >= 0)
+						{
+							packet.max[rayIndex] = t;
+							closestIndices[rayIndex] = index;
+							hitMask |= uint64_t{ 1 } << rayIndex;
+						}
+					}
+				});
+
+			for (uint64_t mask{ hitMask }; mask != 0; mask &= mask - 1)
+			{
+				const int rayIndex{ std::countr_zero(mask) };
+				const int index{ closestIndices[rayIndex] };
+				const Ray ray{ packet.GetRay(rayIndex) };
+
+				HitRecord& hitRecord = hitRecords[rayIndex];
+				hitRecord.didHit = true;
+				hitRecord.materialIndex = materialIndex;
+				hitRecord.t = ray.max;
+				hitRecord.origin = ray.origin + ray.direction * ray.max;
+				hitRecord.normal = Vector3{
+					triangles.Get(TriangleSoA::NormalX)[index],
+					triangles.Get(TriangleSoA::NormalY)[index],
+					triangles.Get(TriangleSoA::NormalZ)[index] };
+			}
+			return hitMask;
+		}
+
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			return HitTest_Triangles(mesh.bvh, mesh.triangles, mesh.cullMode, mesh.materialIndex, ray, hitRecord);
+		}
+
+		inline bool HitTest_TriangleMesh(const TriangleMesh& mesh, const Ray& ray)
+		{
+			return HitTest_Triangles(mesh.bvh, mesh.triangles, mesh.cullMode, ray);
+		}
+
+		inline uint64_t HitTest_TriangleMeshPacket(const TriangleMesh& mesh, RayPacket& packet, uint64_t rayMask, HitRecord* hitRecords)
+		{
+			return HitTest_TrianglesPacket(mesh.bvh, mesh.triangles, mesh.cullMode, mesh.materialIndex, packet, rayMask, hitRecords);
+		}
+#pragma endregion
+#pragma region TriangleMeshInstance HitTest
+		//Normals go through the inverse transpose to stay perpendicular under non-uniform scale
+		inline Vector3 TransformNormalToWorld(const TriangleMeshInstance& instance, const Vector3& objectNormal)
+		{
+			const Matrix& inverse = instance.inverseWorldTransform;
+			return Vector3{
+				Vector3::Dot(inverse.GetAxisX(), objectNormal),
+				Vector3::Dot(inverse.GetAxisY(), objectNormal),
+				Vector3::Dot(inverse.GetAxisZ(), objectNormal) }.Normalized();
+		}
+
+		inline bool HitTest_TriangleMeshInstance(const TriangleMeshInstance& instance, const Ray& ray, HitRecord& hitRecord, bool ignoreHitRecord = false)
+		{
+			const MeshGeometry& geometry = *instance.pGeometry;
+
+			//The object space direction is not normalized, so t is the same in both spaces
+			const Ray objectRay{
+				instance.inverseWorldTransform.TransformPoint(ray.origin),
+				instance.inverseWorldTransform.TransformVector(ray.direction),
+				ray.min, ray.max };
+
+			if (!HitTest_Triangles(geometry.bvh, geometry.triangles, instance.cullMode, instance.materialIndex, objectRay, hitRecord))
+			{
+				return false;
+			}
+
+			hitRecord.origin = ray.origin + ray.direction * hitRecord.t;
+			hitRecord.normal = TransformNormalToWorld(instance, hitRecord.normal);
+			return true;
+		}
+
+		inline bool HitTest_TriangleMeshInstance(const TriangleMeshInstance& instance, const Ray& ray)
+		{
+			const Ray objectRay{
+				instance.inverseWorldTransform.TransformPoint(ray.origin),
+				instance.inverseWorldTransform.TransformVector(ray.direction),
+				ray.min, ray.max };
+
+			return HitTest_Triangles(instance.pGeometry->bvh, instance.pGeometry->triangles, instance.cullMode, objectRay);
+		}
+
+		//The packet is transformed to object space as a whole, hits are converted back like in the single ray test
+		inline uint64_t HitTest_TriangleMeshInstancePacket(const TriangleMeshInstance& instance, RayPacket& packet, uint64_t rayMask, HitRecord* hitRecords)
+		{
+			const Matrix& inverse = instance.inverseWorldTransform;
+
+			RayPacket objectPacket{};
+			objectPacket.size = packet.size;
+			for (uint64_t mask{ rayMask }; mask != 0; mask &= mask - 1)
+			{
+				const int rayIndex{ std::countr_zero(mask) };
+				const Ray ray{ packet.GetRay(rayIndex) };
+				objectPacket.SetRay(rayIndex, Ray{ inverse.TransformPoint(ray.origin), inverse.TransformVector(ray.direction), ray.min, ray.max });
+			}
+
+			const uint64_t hitMask{ HitTest_TrianglesPacket(instance.pGeometry->bvh, instance.pGeometry->triangles,
+				instance.cullMode, instance.materialIndex, objectPacket, rayMask, hitRecords) };
+
+			for (uint64_t mask{ hitMask }; mask != 0; mask &= mask - 1)
+			{
+				const int rayIndex{ std::countr_zero(mask) };
+				const Ray ray{ packet.GetRay(rayIndex) };
+
+				HitRecord& hitRecord = hitRecords[rayIndex];
+				packet.max[rayIndex] = hitRecord.t;
+				hitRecord.origin = ray.origin + ray.direction * hitRecord.t;
+				hitRecord.normal = TransformNormalToWorld(instance, hitRecord.normal);
+			}
+			return hitMask;
+		}
+#pragma endregion
+	}
+
+	namespace LightUtils
+	{
+		//Direction from target to light
+		inline Vector3 GetDirectionToLight(const Light& light, const Vector3 origin)
+		{
+			Vector3 DirectionToLight{light.origin - origin};
+			return DirectionToLight;
+		}
+
+		inline ColorRGB GetRadiance(const Light& light, const Vector3& target)
+		{
+			Vector3 vectorFromTargetToLight{ light.origin - target };
+			float radius{ vectorFromTargetToLight.SqrMagnitude() };
+
+			return light.color * (light.intensity / radius);
+		}
 	}
 }
\ No newline at end of file
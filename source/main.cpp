@@ -1,19 +1,42 @@
 //External includes
+#if __has_include("vld.h")
 #include "vld.h"
+#endif
 #include "SDL.h"
 #include "SDL_surface.h"
 #undef main
 
 //Standard includes
 #include <iostream>
+#include <vector>
 
 //Project includes
 #include "Timer.h"
 #include "Renderer.h"
 #include "Scene.h"
+#include "CameraRecording.h"
+#include "Trace.h"
 
 using namespace dae;
 
+//Camera input of this frame, read from the SDL keyboard and mouse state
+CameraInput GetCameraInput()
+{
+	const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
+	int mouseX{}, mouseY{};
+	const uint32_t mouseState = SDL_GetRelativeMouseState(&mouseX, &mouseY);
+
+	CameraInput input{};
+	input.moveForward = pKeyboardState[SDL_SCANCODE_W];
+	input.moveBackward = pKeyboardState[SDL_SCANCODE_S];
+	input.moveLeft = pKeyboardState[SDL_SCANCODE_A];
+	input.moveRight = pKeyboardState[SDL_SCANCODE_D];
+	input.isRotating = mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT);
+	input.mouseDeltaX = mouseX;
+	input.mouseDeltaY = mouseY;
+	return input;
+}
+
 void ShutDown(SDL_Window* pWindow)
 {
 	SDL_DestroyWindow(pWindow);
@@ -22,10 +45,6 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
-
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
 
@@ -41,17 +60,29 @@ int main(int argc, char* args[])
 	if (!pWindow)
 		return 1;
 
+	//The renderer writes 0xAARRGGBB pixels, straight into the window surface when it uses that layout
+	SDL_Surface* pWindowSurface = SDL_GetWindowSurface(pWindow);
+	const bool canRenderToSurface = (pWindowSurface->format->format == SDL_PIXELFORMAT_ARGB8888
+		|| pWindowSurface->format->format == SDL_PIXELFORMAT_RGB888) && pWindowSurface->pitch == int(width * 4);
+	std::vector<uint32_t> stagingPixels{};
+	if (!canRenderToSurface)
+		stagingPixels.resize(width * height);
+	uint32_t* pRenderPixels = canRenderToSurface ? static_cast<uint32_t*>(pWindowSurface->pixels) : stagingPixels.data();
+
 	//Initialize "framework"
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow);
+	const auto pRenderer = new Renderer(pRenderPixels, width, height);
 
 	//const auto pScene = new Scene_W1();
 	//const auto pScene = new Scene_W2();
 	//const auto pScene = new Scene_W3_TestScene();
 	//const auto pScene = new Scene_W3();
 	//const auto pScene = new Scene_W4_TestScene();
-	const auto pScene = new Scene_W4_ReferenceScene();
 	//const auto pScene = new Scene_W4_Bunny();
+	//A scene name or .scene file can be passed on the command line, the reference scene is shown without one
+	Scene* pScene = argc > 1 ? CreateScene(args[1]).release() : nullptr;
+	if (!pScene)
+		pScene = new Scene_W4_ReferenceScene();
 	pScene->Initialize();
 
 	//Start loop
@@ -59,8 +90,13 @@ int main(int argc, char* args[])
 	float printTimer = 0.f;
 	bool isLooping = true;
 	bool takeScreenshot = false;
+	bool isRecording = false;
+	CameraRecording recording{};
+	Trace::SetThreadName("Main");
 	while (isLooping)
 	{
+		const TraceScope frameScope{ "Frame" };
+
 		//--------- Get input events ---------
 		SDL_Event e;
 		while (SDL_PollEvent(&e))
@@ -77,15 +113,63 @@ int main(int argc, char* args[])
 					pRenderer->ToggleShadows();
 				else if (e.key.keysym.scancode == SDL_SCANCODE_F3)
 					pRenderer->CycleLightingMode();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F4)
+					pRenderer->TogglePacketTracing();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+					pRenderer->CycleExecutionMode();
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F6)
+				{
+					//Toggle camera recording, saved for RayTracerBatch --replay when it stops
+					isRecording = !isRecording;
+					if (isRecording)
+					{
+						recording.Clear();
+						std::cout << "Camera recording started\n";
+					}
+					else if (recording.SaveToFile("CameraRecording.rtci"))
+						std::cout << "Camera recording saved (" << recording.GetFrameCount() << " frames)\n";
+					else
+						std::cout << "Something went wrong. Camera recording not saved!\n";
+				}
+				else if (e.key.keysym.scancode == SDL_SCANCODE_F7)
+				{
+					//Toggle trace capture, saved as Chrome trace JSON for chrome://tracing or Perfetto when it stops
+					Trace::SetEnabled(!Trace::IsEnabled());
+					if (Trace::IsEnabled())
+					{
+						Trace::Clear();
+						std::cout << "Trace capture started\n";
+					}
+					else if (Trace::SaveToFile("RayTracing_Trace.json"))
+						std::cout << "Trace saved!\n";
+					else
+						std::cout << "Something went wrong. Trace not saved!\n";
+				}
 				break;
 			}
 		}
 
 		//--------- Update ---------
-		pScene->Update(pTimer);
+		const CameraInput cameraInput{ GetCameraInput() };
+		if (isRecording)
+			recording.Record(cameraInput, pTimer->GetElapsed());
+		pScene->SetCameraInput(cameraInput);
+		{
+			const TraceScope traceScope{ "Scene::Update" };
+			pScene->Update(pTimer);
+		}
 
 		//--------- Render ---------
 		pRenderer->Render(pScene);
+		{
+			const TraceScope traceScope{ "SDL_UpdateWindowSurface" };
+			if (!canRenderToSurface)
+			{
+				SDL_ConvertPixels(width, height, SDL_PIXELFORMAT_ARGB8888, stagingPixels.data(), width * 4,
+					pWindowSurface->format->format, pWindowSurface->pixels, pWindowSurface->pitch);
+			}
+			SDL_UpdateWindowSurface(pWindow);
+		}
 
 		//--------- Timer ---------
 		pTimer->Update();
@@ -99,7 +183,7 @@ int main(int argc, char* args[])
 		//Save screenshot after full render
 		if (takeScreenshot)
 		{
-			if (!pRenderer->SaveBufferToImage())
+			if (pRenderer->SaveBufferToImage())
 				std::cout << "Screenshot saved!" << std::endl;
 			else
 				std::cout << "Something went wrong. Screenshot not saved!" << std::endl;